@@ -62,6 +62,15 @@
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
+/*
+ * Set USE_THP to "1" to back the heap with a THP_PAGESIZE-aligned region
+ * that is advised for transparent huge pages. The heap is then grown in
+ * multiples of THP_PAGESIZE (see mem_growsize in memlib.c), so walking
+ * headers and free lists on a large heap touches far fewer TLB entries.
+ */
+#define USE_THP 0
+#define THP_PAGESIZE (2*(1<<20))  /* 2 MB */
+
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
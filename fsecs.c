@@ -54,4 +54,23 @@ double fsecs(fsecs_test_funct f, void *argp)
 #endif 
 }
 
+/*
+ * fsecs_once - Return the running time of a single run of f (in seconds),
+ *     measured with the same timer as fsecs. Unlike fsecs, nothing is
+ *     averaged away, so costs that only the first run pays (e.g., page
+ *     faults on fresh memory) show up in full.
+ */
+double fsecs_once(fsecs_test_funct f, void *argp)
+{
+#if USE_FCYC
+    start_counter();
+    f(argp);
+    return get_counter()/(Mhz*1e6);
+#elif USE_ITIMER
+    return ftimer_itimer(f, argp, 1);
+#elif USE_GETTOD
+    return ftimer_gettod(f, argp, 1);
+#endif
+}
+
 
@@ -19,6 +19,7 @@
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "perfctr.h"
 #include "config.h"
 
 /**********************
@@ -29,9 +30,17 @@
 #define MAXLINE     1024 /* max string size */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define MAXPOOLS      64 /* max distinct object sizes of pool requests in a trace */
+#define LONGAGE     4096 /* allocations after which a live block counts as long lived (-L) */
+#define LIFEMIN        8 /* fewest blocks of a size to hint it (-L); fewer are too few to judge by */
+#define LIFEBUCKETS 4096 /* request sizes that lifetimes are learned for (-L) */
+#define COMPACTBUDGET 4096 /* bytes one mm_compact step may copy (-C) */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((unsigned long)(p)) % ALIGNMENT) == 0)
+
+/* Returns the statistics bucket of a request size; larger ones share the last */
+#define LIFEBUCKET(size) ((size) < LIFEBUCKETS ? (size) : LIFEBUCKETS - 1)
 
 /****************************** 
  * The key compound data types 
@@ -46,9 +55,15 @@ typedef struct range_t {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    enum {ALLOC, FREE, REALLOC, CALLOC, MEMALIGN,
+	  ALLOC_BATCH, FREE_BATCH, POOL_ALLOC, POOL_FREE,
+	  HALLOC, HFREE, HPIN, HUNPIN} type; /* type of request */
     int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
+    int size;                         /* byte size of alloc/realloc/calloc request */
+    int align;                        /* alignment of a memalign request */
+    int count;                        /* ids index..index+count-1 of a batch request */
+    int pool;                         /* pool of a pool request, see pool_sizes */
+    int life;                         /* expected lifetime of an alloc request, MM_LIFE_xxx */
 } traceop_t;
 
 /* Holds the information for one trace file*/
@@ -60,6 +75,9 @@ typedef struct {
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    mm_handle_t *handles; /* mm handles of the ids of handle requests */
+    int num_pools;       /* number of distinct pool request sizes... */
+    int pool_sizes[MAXPOOLS]; /* ... and the object size of each pool */
 } trace_t;
 
 /* 
@@ -78,9 +96,20 @@ typedef struct {
     double ops;      /* number of ops (malloc/free/realloc) in the trace */
     int valid;       /* was the trace processed correctly by the allocator? */
     double secs;     /* number of secs needed to run the trace */
+    double cold_secs;/* secs for the first run, on a freshly mapped heap */
+    double copied;   /* payload bytes moved by realloc in the validity run */
+    double dtlb;     /* dTLB misses for one run of the trace (-1 if unknown) */
+    double cmiss;    /* cache misses for one run of the trace (-1 if unknown) */
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double quickhit; /* fraction of quick list lookups that hit (-1 for libc) */
+    double probes;   /* free blocks examined per free list search (-1 for libc) */
+    double zeroskip; /* bytes mm_calloc found already zero (-1 for libc) */
+    double aligngap; /* bytes mm_memalign split off in front of its blocks (-1 for libc) */
+    double compacted;/* bytes mm_compact copied (-1 for libc) */
+    double pause;    /* longest mm_compact step in secs (-1 for libc) */
+    double meanpause;/* average mm_compact step in secs (-1 for libc) */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -90,6 +119,17 @@ typedef struct {
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int count_dtlb = 0; /* if set, count dTLB misses for each trace (-d) */
+static int count_cmiss = 0; /* if set, count cache misses for each trace (-c) */
+static int prefault = 0;   /* if set, pre-fault the simulated heap (-p) */
+static int sized_free = 0; /* if set, free with mm_free_sized (-s) */
+static int try_expand = 0; /* if set, grow blocks with mm_try_expand first (-e) */
+static int learn_life = 0; /* if set, learn lifetime hints for alloc requests (-L) */
+static int compact = 0;    /* if set, take a compaction step after each handle free (-C) */
+static mm_pool_t *mm_pools[MAXPOOLS]; /* mm pools of the trace being run, made on first use */
+static double realloc_copied; /* bytes moved by realloc, set by eval_xx_valid */
+static double compact_pause; /* longest mm_compact step, set by eval_mm_util... */
+static double compact_secs;  /* ... and the time all of them took */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -113,6 +153,7 @@ static void clear_ranges(range_t **ranges);
 
 /* These functions read, allocate, and free storage for traces */
 static trace_t *read_trace(char *tracedir, char *filename);
+static void learn_lifetimes(trace_t *trace);
 static void free_trace(trace_t *trace);
 
 /* Routines for evaluating the correctness and speed of libc malloc */
@@ -126,6 +167,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
 
 /* Various helper routines */
+static void *mm_alloc(int size, int life);
+static void *mm_resize(void *p, int oldsize, int size);
+static mm_pool_t *mm_pool(trace_t *trace, int pool);
+static double mm_compact_step(void);
 static void printresults(int n, stats_t *stats);
 static void usage(void);
 static void unix_error(char *msg);
@@ -146,6 +191,7 @@ int main(int argc, char **argv)
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
+    mm_counters_t counters;    /* mm event counters for the util run */
 
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
@@ -158,7 +204,7 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:hvVgaldcpseLC")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -181,9 +227,32 @@ int main(int argc, char **argv)
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
+        case 'p': /* Pre-fault the simulated heap */
+            prefault = 1;
+            break;
+        case 's': /* Free with mm_free_sized */
+            sized_free = 1;
+            break;
+        case 'e': /* Grow blocks in place with mm_try_expand before mm_realloc */
+            try_expand = 1;
+            break;
+        case 'L': /* Learn lifetime hints for alloc requests */
+            learn_life = 1;
+            break;
+        case 'C': /* Compact handle blocks a step at a time */
+            compact = 1;
+            break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'd': /* Count dTLB misses (implies -v) */
+            count_dtlb = 1;
+            verbose = verbose ? verbose : 1;
+            break;
+        case 'c': /* Count cache misses (implies -v) */
+            count_cmiss = 1;
+            verbose = verbose ? verbose : 1;
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -257,11 +326,26 @@ int main(int argc, char **argv)
 	    if (verbose > 1)
 		printf("Checking libc malloc for correctness, ");
 	    libc_stats[i].valid = eval_libc_valid(trace, i);
+	    libc_stats[i].copied = realloc_copied;
+	    libc_stats[i].quickhit = -1;
+	    libc_stats[i].probes = -1;
+	    libc_stats[i].zeroskip = -1;
+	    libc_stats[i].aligngap = -1;
+	    libc_stats[i].compacted = -1;
+	    libc_stats[i].pause = -1;
+	    libc_stats[i].meanpause = -1;
 	    if (libc_stats[i].valid) {
 		speed_params.trace = trace;
 		if (verbose > 1)
 		    printf("and performance.\n");
+		libc_stats[i].cold_secs = fsecs_once(eval_libc_speed, &speed_params);
 		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+		if (count_dtlb)
+		    libc_stats[i].dtlb = perfctr(PERFCTR_DTLB_MISSES,
+						 eval_libc_speed, &speed_params);
+		if (count_cmiss)
+		    libc_stats[i].cmiss = perfctr(PERFCTR_CACHE_MISSES,
+						  eval_libc_speed, &speed_params);
 	    }
 	    free_trace(trace);
 	}
@@ -285,6 +369,7 @@ int main(int argc, char **argv)
 	unix_error("mm_stats calloc in main failed");
     
     /* Initialize the simulated memory system in memlib.c */
+    mem_set_prefault(prefault);
     mem_init(); 
 
     /* Evaluate student's mm malloc package using the K-best scheme */
@@ -294,15 +379,49 @@ int main(int argc, char **argv)
 	if (verbose > 1)
 	    printf("Checking mm_malloc for correctness, ");
 	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
+	mm_stats[i].copied = realloc_copied;
 	if (mm_stats[i].valid) {
 	    if (verbose > 1)
 		printf("efficiency, ");
+
+	    /* 
+	     * Run on freshly mapped storage, as a new process would, so the
+	     * counters show how much calloc zeroing a fresh heap saves
+	     */
+	    mem_deinit();
+	    mem_init();
 	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_counters(&counters);
+	    mm_stats[i].quickhit = (counters.quick_hits + counters.quick_misses) ?
+		(double)counters.quick_hits / 
+		(counters.quick_hits + counters.quick_misses) : 0;
+	    mm_stats[i].probes = counters.fit_searches ?
+		(double)counters.fit_probes / counters.fit_searches : 0;
+	    mm_stats[i].zeroskip = counters.zero_skipped;
+	    mm_stats[i].aligngap = counters.align_gap_bytes;
+	    mm_stats[i].compacted = counters.compact_bytes;
+	    mm_stats[i].pause = compact_pause;
+	    mm_stats[i].meanpause = counters.compact_steps ?
+		compact_secs / counters.compact_steps : 0;
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
 		printf("and performance.\n");
+
+	    /* 
+	     * Time one run on a freshly mapped heap, so first-touch page
+	     * faults are reported apart from the steady-state throughput 
+	     */
+	    mem_deinit();
+	    mem_init();
+	    mm_stats[i].cold_secs = fsecs_once(eval_mm_speed, &speed_params);
 	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (count_dtlb)
+		mm_stats[i].dtlb = perfctr(PERFCTR_DTLB_MISSES,
+					   eval_mm_speed, &speed_params);
+	    if (count_cmiss)
+		mm_stats[i].cmiss = perfctr(PERFCTR_CACHE_MISSES,
+					    eval_mm_speed, &speed_params);
 	}
 	free_trace(trace);
     }
@@ -383,6 +502,7 @@ static int add_range(range_t **ranges, char *lo, int size,
 {
     char *hi = lo + size - 1;
     range_t *p;
+    mem_region_t *r;
     char msg[MAXLINE];
 
     assert(size > 0);
@@ -395,11 +515,11 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of a heap */
+    if (((r = mem_region_of(lo)) == NULL) || (hi > (char *)mem_region_hi(r))) {
+	r = r ? r : mem_default_region();
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
-		lo, hi, mem_heap_lo(), mem_heap_hi());
+		lo, hi, mem_region_lo(r), mem_region_hi(r));
 	malloc_error(tracenum, opnum, msg);
         return 0;
     }
@@ -477,9 +597,10 @@ static trace_t *read_trace(char *tracedir, char *filename)
     trace_t *trace;
     char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
+    unsigned index, size, align, count;
     unsigned max_index = 0;
     unsigned op_index;
+    int *id_pools, pool;
 
     if (verbose > 1)
 	printf("Reading tracefile: %s\n", filename);
@@ -514,11 +635,22 @@ static trace_t *read_trace(char *tracedir, char *filename)
     if ((trace->block_sizes = 
 	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
 	unix_error("malloc 4 failed in read_trace");
+
+    /* ... and the mm handle of each id of a handle request */
+    if ((trace->handles = 
+	 (mm_handle_t *)malloc(trace->num_ids * sizeof(mm_handle_t))) == NULL)
+	unix_error("malloc 5 failed in read_trace");
+
+    /* The pool each id was last allocated from, for its p request */
+    if ((id_pools = (int *)calloc(trace->num_ids, sizeof(int))) == NULL)
+	unix_error("malloc 6 failed in read_trace");
+    trace->num_pools = 0;
     
     /* read every request line in the trace file */
     index = 0;
     op_index = 0;
     while (fscanf(tracefile, "%s", type) != EOF) {
+	trace->ops[op_index].life = MM_LIFE_SHORT;
 	switch(type[0]) {
 	case 'a':
 	    fscanf(tracefile, "%u %u", &index, &size);
@@ -527,6 +659,29 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    trace->ops[op_index].size = size;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
+	case 'l': /* l <id> <size> <lifetime>: an alloc with a lifetime hint */
+	    fscanf(tracefile, "%u %u %u", &index, &size, &align);
+	    trace->ops[op_index].type = ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].life = align;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'c':
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = CALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    fscanf(tracefile, "%u %u %u", &index, &size, &align);
+	    trace->ops[op_index].type = MEMALIGN;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = align;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
 	case 'r':
 	    fscanf(tracefile, "%u %u", &index, &size);
 	    trace->ops[op_index].type = REALLOC;
@@ -539,6 +694,58 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    trace->ops[op_index].type = FREE;
 	    trace->ops[op_index].index = index;
 	    break;
+	case 'A': /* A <id> <count> <size>: count allocs with consecutive ids */
+	    fscanf(tracefile, "%u %u %u", &index, &count, &size);
+	    trace->ops[op_index].type = ALLOC_BATCH;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].count = count;
+	    trace->ops[op_index].size = size;
+	    max_index = (index + count - 1 > max_index) ? index + count - 1 : max_index;
+	    break;
+	case 'F': /* F <id> <count>: frees the ids an A request allocated */
+	    fscanf(tracefile, "%u %u", &index, &count);
+	    trace->ops[op_index].type = FREE_BATCH;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].count = count;
+	    break;
+	case 'P': /* P <id> <size>: allocates from the pool of size-byte objects */
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    for (pool = 0; pool < trace->num_pools; pool++)
+		if (trace->pool_sizes[pool] == size)
+		    break;
+	    if (pool == trace->num_pools) {
+		if (pool == MAXPOOLS)
+		    app_error("Too many pool sizes in read_trace");
+		trace->pool_sizes[trace->num_pools++] = size;
+	    }
+	    trace->ops[op_index].type = POOL_ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].pool = pool;
+	    id_pools[index] = pool;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'p': /* p <id>: frees an id a P request allocated */
+	    fscanf(tracefile, "%u", &index);
+	    trace->ops[op_index].type = POOL_FREE;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].pool = id_pools[index];
+	    break;
+	case 'H': /* H <id> <size>: allocates a relocatable block by handle */
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = HALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'h': /* h <id>: frees the block of an H request */
+	case 'K': /* K <id>: pins it where it is... */
+	case 'k': /* k <id>: ... and unpins it */
+	    fscanf(tracefile, "%u", &index);
+	    trace->ops[op_index].type = (type[0] == 'h') ? HFREE :
+		(type[0] == 'K') ? HPIN : HUNPIN;
+	    trace->ops[op_index].index = index;
+	    break;
 	default:
 	    printf("Bogus type character (%c) in tracefile %s\n", 
 		   type[0], path);
@@ -548,14 +755,86 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	
     }
     fclose(tracefile);
+    free(id_pools);
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
+
+    if (learn_life)
+	learn_lifetimes(trace);
     
     return trace;
 }
 
 /*
- * free_trace - Free the trace record and the three arrays it points
+ * learn_lifetimes - Replace the lifetime hints of the alloc requests in
+ *     the trace with ones learned from a profiling replay of it. Requests
+ *     are grouped by their exact size, much as a program's objects of one
+ *     type share a size, and the clock is the number of allocs so far.
+ *     A block lives long if LONGAGE allocs pass before it is freed. A
+ *     block still live when the trace stops allocating lives long if it
+ *     is that old by then, and tells nothing otherwise. The allocs of a
+ *     size are hinted MM_LIFE_LONG if at least LIFEMIN of its blocks
+ *     were seen and at least three quarters of them lived long.
+ */
+static void learn_lifetimes(trace_t *trace)
+{
+    int blocks[LIFEBUCKETS], lived[LIFEBUCKETS];
+    int *born, *bucket;
+    int i, id, b, last, clock = 0;
+
+    memset(blocks, 0, sizeof(blocks));
+    memset(lived, 0, sizeof(lived));
+    if ((born = (int *)calloc(trace->num_ids, sizeof(int))) == NULL ||
+	(bucket = (int *)calloc(trace->num_ids, sizeof(int))) == NULL)
+	unix_error("calloc failed in learn_lifetimes");
+
+    /* Frees after the last alloc only tear the program down */
+    for (last = trace->num_ops - 1; last >= 0; last--)
+	if (trace->ops[last].type == ALLOC)
+	    break;
+
+    /* Replay the allocs and frees, recording how long each block lived */
+    for (i = 0; i <= last; i++) {
+	id = trace->ops[i].index;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    born[id] = clock++;
+	    bucket[id] = LIFEBUCKET(trace->ops[i].size) + 1;
+	    break;
+	case FREE:
+	    if (bucket[id]) {
+		blocks[bucket[id] - 1]++;
+		if (clock - born[id] >= LONGAGE)
+		    lived[bucket[id] - 1]++;
+	    }
+	    bucket[id] = 0;
+	    break;
+	case REALLOC: /* a resized block leaves the statistics */
+	    bucket[id] = 0;
+	    break;
+	default:
+	    break;
+	}
+    }
+    for (id = 0; id < trace->num_ids; id++)
+	if (bucket[id] && clock - born[id] >= LONGAGE) {
+	    blocks[bucket[id] - 1]++;
+	    lived[bucket[id] - 1]++;
+	}
+
+    /* Hint the allocs of the sizes whose blocks mostly lived long */
+    for (i = 0; i < trace->num_ops; i++)
+	if (trace->ops[i].type == ALLOC) {
+	    b = LIFEBUCKET(trace->ops[i].size);
+	    trace->ops[i].life = (blocks[b] >= LIFEMIN && 4 * lived[b] >= 3 * blocks[b]) ?
+		MM_LIFE_LONG : MM_LIFE_SHORT;
+	}
+    free(born);
+    free(bucket);
+}
+
+/*
+ * free_trace - Free the trace record and the four arrays it points
  *              to, all of which were allocated in read_trace().
  */
 void free_trace(trace_t *trace)
@@ -563,6 +842,7 @@ void free_trace(trace_t *trace)
     free(trace->ops);         /* free the three arrays... */
     free(trace->blocks);      
     free(trace->block_sizes);
+    free(trace->handles);
     free(trace);              /* and the trace record itself... */
 }
 
@@ -576,7 +856,8 @@ void free_trace(trace_t *trace)
  */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
 {
-    int i, j;
+    int i, j, n;
+    mm_handle_t h;
     int index;
     int size;
     int oldsize;
@@ -584,15 +865,16 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     char *oldp;
     char *p;
     
-    /* Reset the heap and free any records in the range list */
-    mem_reset_brk();
+    /* Free any records in the range list */
     clear_ranges(ranges);
+    realloc_copied = 0;
 
-    /* Call the mm package's init function */
-    if (mm_init() < 0) {
-	malloc_error(tracenum, 0, "mm_init failed.");
+    /* Empty the mm package's heap */
+    if (mm_heap_reset(NULL) < 0) {
+	malloc_error(tracenum, 0, "mm_heap_reset failed.");
 	return 0;
     }
+    memset(mm_pools, 0, sizeof(mm_pools)); /* the pools went with the heap */
 
     /* Interpret each operation in the trace in order */
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -602,9 +884,17 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
-
-	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
+
+	    /* Call the student's malloc, calloc or memalign */
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc(1, size);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_alloc(size, trace->ops[i].life);
+	    if (p == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -616,6 +906,29 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     */ 
 	    if (add_range(ranges, p, size, tracenum, i) == 0)
 		return 0;
+
+	    /* An aligned block must honor the requested alignment */
+	    if (trace->ops[i].type == MEMALIGN &&
+		(unsigned long)p % trace->ops[i].align != 0) {
+		malloc_error(tracenum, i, "mm_memalign returned a misaligned block");
+		return 0;
+	    }
+
+	    /* The block must hold at least the requested size */
+	    if (mm_usable_size(p) < size) {
+		malloc_error(tracenum, i, "mm_usable_size is less than the request");
+		return 0;
+	    }
+
+	    /* A calloc'd block must read as zero */
+	    if (trace->ops[i].type == CALLOC) {
+		for (j = 0; j < size; j++) {
+		    if (p[j] != 0) {
+			malloc_error(tracenum, i, "mm_calloc did not zero the block");
+			return 0;
+		    }
+		}
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -633,17 +946,26 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    if ((newp = mm_resize(oldp, trace->block_sizes[index], size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
 	    
 	    /* Remove the old region from the range list */
 	    remove_range(ranges, oldp);
+
+	    /* A block that moved had its old payload copied */
+	    oldsize = trace->block_sizes[index];
+	    if (newp != oldp)
+		realloc_copied += (size < oldsize) ? size : oldsize;
 	    
 	    /* Check new block for correctness and add it to range list */
 	    if (add_range(ranges, newp, size, tracenum, i) == 0)
 		return 0;
+	    if (mm_usable_size(newp) < size) {
+		malloc_error(tracenum, i, "mm_usable_size is less than the request");
+		return 0;
+	    }
 	    
 	    /* ADDED: cgw
 	     * Make sure that the new block contains the data from the old 
@@ -653,7 +975,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -671,7 +993,112 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    if (sized_free)
+		mm_free_sized(p, trace->block_sizes[index]);
+	    else
+		mm_free(p);
+	    break;
+
+        case ALLOC_BATCH: /* mm_malloc_batch */
+	    n = trace->ops[i].count;
+	    if (mm_malloc_batch(size, n, (void **)&trace->blocks[index]) != n) {
+		malloc_error(tracenum, i, "mm_malloc_batch failed.");
+		return 0;
+	    }
+
+	    /* Check each block as a single malloc's and fill it likewise */
+	    for (j = index; j < index + n; j++) {
+		p = trace->blocks[j];
+		if (add_range(ranges, p, size, tracenum, i) == 0)
+		    return 0;
+		memset(p, j & 0xFF, size);
+		trace->block_sizes[j] = size;
+	    }
+	    break;
+
+        case FREE_BATCH: /* mm_free_batch */
+	    n = trace->ops[i].count;
+	    for (j = index; j < index + n; j++)
+		remove_range(ranges, trace->blocks[j]);
+	    mm_free_batch((void **)&trace->blocks[index], n);
+	    break;
+
+        case POOL_ALLOC: /* mm_pool_alloc */
+	    if ((p = mm_pool_alloc(mm_pool(trace, trace->ops[i].pool))) == NULL) {
+		malloc_error(tracenum, i, "mm_pool_alloc failed.");
+		return 0;
+	    }
+	    if (add_range(ranges, p, size, tracenum, i) == 0)
+		return 0;
+	    memset(p, index & 0xFF, size);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    break;
+
+        case POOL_FREE: /* mm_pool_free */
+	    p = trace->blocks[index];
+	    remove_range(ranges, p);
+	    mm_pool_free(mm_pool(trace, trace->ops[i].pool), p);
+	    break;
+
+        case HALLOC: /* mm_halloc */
+	    if ((h = mm_halloc(size)) == 0) {
+		malloc_error(tracenum, i, "mm_halloc failed.");
+		return 0;
+	    }
+
+	    /* 
+	     * The block may move, so it is not put on the range list. It
+	     * must lie in a heap, and hold its fill whenever it is pinned.
+	     */
+	    p = mm_hpin(h);
+	    if (!IS_ALIGNED(p) || mem_region_of(p) == NULL ||
+		p + size - 1 > (char *)mem_region_hi(mem_region_of(p))) {
+		malloc_error(tracenum, i, "mm_halloc block is misaligned or outside the heap");
+		return 0;
+	    }
+	    memset(p, index & 0xFF, size);
+	    mm_hunpin(h);
+	    trace->handles[index] = h;
+	    trace->block_sizes[index] = size;
+	    break;
+
+        case HPIN: /* mm_hpin */
+	    p = mm_hpin(trace->handles[index]);
+	    for (j = 0; j < trace->block_sizes[index]; j++) {
+		if ((unsigned char)p[j] != (index & 0xFF)) {
+		    malloc_error(tracenum, i, "mm_compact did not preserve the "
+				 "data of a handle block");
+		    return 0;
+		}
+	    }
+	    trace->blocks[index] = p;
+	    break;
+
+        case HUNPIN: /* mm_hunpin */
+	    h = trace->handles[index];
+	    if (mm_hpin(h) != trace->blocks[index]) {
+		malloc_error(tracenum, i, "mm_compact moved a pinned block");
+		return 0;
+	    }
+	    mm_hunpin(h);
+	    mm_hunpin(h);
+	    break;
+
+        case HFREE: /* mm_hfree */
+	    h = trace->handles[index];
+	    p = mm_hpin(h);
+	    for (j = 0; j < trace->block_sizes[index]; j++) {
+		if ((unsigned char)p[j] != (index & 0xFF)) {
+		    malloc_error(tracenum, i, "mm_compact did not preserve the "
+				 "data of a handle block");
+		    return 0;
+		}
+	    }
+	    mm_hunpin(h);
+	    mm_hfree(h);
+	    if (compact)
+		mm_compact_step();
 	    break;
 
 	default:
@@ -697,27 +1124,37 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  */
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 {   
-    int i;
+    int i, j, n;
     int index;
     int size, newsize, oldsize;
     int max_total_size = 0;
     int total_size = 0;
     char *p;
     char *newp, *oldp;
+    double secs;
 
-    /* initialize the heap and the mm malloc package */
-    mem_reset_brk();
-    if (mm_init() < 0)
-	app_error("mm_init failed in eval_mm_util");
+    /* Empty the mm malloc package's heap */
+    if (mm_heap_reset(NULL) < 0)
+	app_error("mm_heap_reset failed in eval_mm_util");
+    memset(mm_pools, 0, sizeof(mm_pools));
+    compact_pause = compact_secs = 0;
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc(1, size);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_alloc(size, trace->ops[i].life);
+	    if (p == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -739,7 +1176,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    if ((newp = mm_resize(oldp, oldsize, newsize)) == NULL)
 		app_error("mm_realloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -760,7 +1197,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    if (sized_free)
+		mm_free_sized(p, size);
+	    else
+		mm_free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -768,13 +1208,82 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    break;
 
+        case ALLOC_BATCH: /* mm_malloc_batch */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    n = trace->ops[i].count;
+	    if (mm_malloc_batch(size, n, (void **)&trace->blocks[index]) != n)
+		app_error("mm_malloc_batch failed in eval_mm_util");
+	    for (j = index; j < index + n; j++)
+		trace->block_sizes[j] = size;
+	    total_size += n * size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case FREE_BATCH: /* mm_free_batch */
+	    index = trace->ops[i].index;
+	    n = trace->ops[i].count;
+	    for (j = index; j < index + n; j++)
+		total_size -= trace->block_sizes[j];
+	    mm_free_batch((void **)&trace->blocks[index], n);
+	    break;
+
+        case POOL_ALLOC: /* mm_pool_alloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = mm_pool_alloc(mm_pool(trace, trace->ops[i].pool))) == NULL)
+		app_error("mm_pool_alloc failed in eval_mm_util");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case POOL_FREE: /* mm_pool_free */
+	    index = trace->ops[i].index;
+	    total_size -= trace->block_sizes[index];
+	    mm_pool_free(mm_pool(trace, trace->ops[i].pool), trace->blocks[index]);
+	    break;
+
+        case HALLOC: /* mm_halloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((trace->handles[index] = mm_halloc(size)) == 0)
+		app_error("mm_halloc failed in eval_mm_util");
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case HPIN: /* mm_hpin */
+	    mm_hpin(trace->handles[trace->ops[i].index]);
+	    break;
+
+        case HUNPIN: /* mm_hunpin */
+	    mm_hunpin(trace->handles[trace->ops[i].index]);
+	    break;
+
+        case HFREE: /* mm_hfree */
+	    index = trace->ops[i].index;
+	    total_size -= trace->block_sizes[index];
+	    mm_hfree(trace->handles[index]);
+	    if (compact) {
+		secs = mm_compact_step();
+		compact_secs += secs;
+		compact_pause = (secs > compact_pause) ? secs : compact_pause;
+	    }
+	    break;
+
 	default:
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    return ((double)max_total_size / (double)mem_footprint());
 }
 
 
@@ -784,14 +1293,14 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
  */
 static void eval_mm_speed(void *ptr)
 {
-    int i, index, size, newsize;
+    int i, j, index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
 
-    /* Reset the heap and initialize the mm package */
-    mem_reset_brk();
-    if (mm_init() < 0) 
-	app_error("mm_init failed in eval_mm_speed");
+    /* Empty the mm package's heap */
+    if (mm_heap_reset(NULL) < 0) 
+	app_error("mm_heap_reset failed in eval_mm_speed");
+    memset(mm_pools, 0, sizeof(mm_pools));
 
     /* Interpret each trace request */
     for (i = 0;  i < trace->num_ops;  i++)
@@ -800,24 +1309,93 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = mm_alloc(size, trace->ops[i].life)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+            break;
+
+        case CALLOC: /* mm_calloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_calloc(1, size)) == NULL)
+		app_error("mm_calloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+            break;
+
+        case MEMALIGN: /* mm_memalign */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_memalign(trace->ops[i].align, size)) == NULL)
+		app_error("mm_memalign error in eval_mm_speed");
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
             break;
 
 	case REALLOC: /* mm_realloc */
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+            if ((newp = mm_resize(oldp, trace->block_sizes[index], newsize)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
+            trace->block_sizes[index] = newsize;
             break;
 
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            if (sized_free)
+                mm_free_sized(block, trace->block_sizes[index]);
+            else
+                mm_free(block);
+            break;
+
+        case ALLOC_BATCH: /* mm_malloc_batch */
+            index = trace->ops[i].index;
+            if (mm_malloc_batch(trace->ops[i].size, trace->ops[i].count,
+				(void **)&trace->blocks[index]) != trace->ops[i].count)
+		app_error("mm_malloc_batch error in eval_mm_speed");
+            for (j = index; j < index + trace->ops[i].count; j++)
+                trace->block_sizes[j] = trace->ops[i].size;
+            break;
+
+        case FREE_BATCH: /* mm_free_batch */
+            index = trace->ops[i].index;
+            mm_free_batch((void **)&trace->blocks[index], trace->ops[i].count);
+            break;
+
+        case POOL_ALLOC: /* mm_pool_alloc */
+            index = trace->ops[i].index;
+            if ((p = mm_pool_alloc(mm_pool(trace, trace->ops[i].pool))) == NULL)
+		app_error("mm_pool_alloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
+        case POOL_FREE: /* mm_pool_free */
+            index = trace->ops[i].index;
+            mm_pool_free(mm_pool(trace, trace->ops[i].pool), trace->blocks[index]);
+            break;
+
+        case HALLOC: /* mm_halloc */
+            index = trace->ops[i].index;
+            if ((trace->handles[index] = mm_halloc(trace->ops[i].size)) == 0)
+		app_error("mm_halloc error in eval_mm_speed");
+            break;
+
+        case HPIN: /* mm_hpin */
+            mm_hpin(trace->handles[trace->ops[i].index]);
+            break;
+
+        case HUNPIN: /* mm_hunpin */
+            mm_hunpin(trace->handles[trace->ops[i].index]);
+            break;
+
+        case HFREE: /* mm_hfree */
+            mm_hfree(trace->handles[trace->ops[i].index]);
+            if (compact)
+                mm_compact(COMPACTBUDGET);
             break;
 
 	default:
@@ -833,9 +1411,10 @@ static void eval_mm_speed(void *ptr)
  */
 static int eval_libc_valid(trace_t *trace, int tracenum)
 {
-    int i, newsize;
+    int i, j, newsize, oldsize;
     char *p, *newp, *oldp;
 
+    realloc_copied = 0;
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
@@ -845,6 +1424,26 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 		unix_error("System message");
 	    }
 	    trace->blocks[trace->ops[i].index] = p;
+	    trace->block_sizes[trace->ops[i].index] = trace->ops[i].size;
+	    break;
+
+        case CALLOC: /* calloc */
+	    if ((p = calloc(1, trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc calloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    trace->block_sizes[trace->ops[i].index] = trace->ops[i].size;
+	    break;
+
+        case MEMALIGN: /* posix_memalign */
+	    if (posix_memalign((void **)&p, trace->ops[i].align,
+			       trace->ops[i].size) != 0) {
+		malloc_error(tracenum, i, "libc posix_memalign failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    trace->block_sizes[trace->ops[i].index] = trace->ops[i].size;
 	    break;
 
 	case REALLOC: /* realloc */
@@ -854,13 +1453,63 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 		malloc_error(tracenum, i, "libc realloc failed");
 		unix_error("System message");
 	    }
+	    oldsize = trace->block_sizes[trace->ops[i].index];
+	    if (newp != oldp)
+		realloc_copied += (newsize < oldsize) ? newsize : oldsize;
 	    trace->blocks[trace->ops[i].index] = newp;
+	    trace->block_sizes[trace->ops[i].index] = newsize;
 	    break;
 	    
         case FREE: /* free */
 	    free(trace->blocks[trace->ops[i].index]);
 	    break;
 
+        case ALLOC_BATCH: /* malloc, one block at a time */
+	    for (j = 0; j < trace->ops[i].count; j++) {
+		if ((p = malloc(trace->ops[i].size)) == NULL) {
+		    malloc_error(tracenum, i, "libc malloc failed");
+		    unix_error("System message");
+		}
+		trace->blocks[trace->ops[i].index + j] = p;
+		trace->block_sizes[trace->ops[i].index + j] = trace->ops[i].size;
+	    }
+	    break;
+
+        case FREE_BATCH: /* free, one block at a time */
+	    for (j = 0; j < trace->ops[i].count; j++)
+		free(trace->blocks[trace->ops[i].index + j]);
+	    break;
+
+        case POOL_ALLOC: /* malloc */
+	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc malloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    trace->block_sizes[trace->ops[i].index] = trace->ops[i].size;
+	    break;
+
+        case POOL_FREE: /* free */
+	    free(trace->blocks[trace->ops[i].index]);
+	    break;
+
+        case HALLOC: /* malloc */
+	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc malloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    trace->block_sizes[trace->ops[i].index] = trace->ops[i].size;
+	    break;
+
+        case HFREE: /* free */
+	    free(trace->blocks[trace->ops[i].index]);
+	    break;
+
+        case HPIN: /* libc blocks never move */
+        case HUNPIN:
+	    break;
+
 	default:
 	    app_error("invalid operation type  in eval_libc_valid");
 	}
@@ -876,7 +1525,7 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
  */
 static void eval_libc_speed(void *ptr)
 {
-    int i;
+    int i, j;
     int index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
@@ -891,6 +1540,22 @@ static void eval_libc_speed(void *ptr)
 	    trace->blocks[index] = p;
 	    break;
 
+        case CALLOC: /* calloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = calloc(1, size)) == NULL)
+		unix_error("calloc failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
+        case MEMALIGN: /* posix_memalign */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if (posix_memalign((void **)&p, trace->ops[i].align, size) != 0)
+		unix_error("posix_memalign failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
 	case REALLOC: /* realloc */
 	    index = trace->ops[i].index;
 	    newsize = trace->ops[i].size;
@@ -906,6 +1571,43 @@ static void eval_libc_speed(void *ptr)
 	    block = trace->blocks[index];
 	    free(block);
 	    break;
+
+        case ALLOC_BATCH: /* malloc, one block at a time */
+	    index = trace->ops[i].index;
+	    for (j = 0; j < trace->ops[i].count; j++)
+		if ((trace->blocks[index + j] = malloc(trace->ops[i].size)) == NULL)
+		    unix_error("malloc failed in eval_libc_speed");
+	    break;
+
+        case FREE_BATCH: /* free, one block at a time */
+	    index = trace->ops[i].index;
+	    for (j = 0; j < trace->ops[i].count; j++)
+		free(trace->blocks[index + j]);
+	    break;
+
+        case POOL_ALLOC: /* malloc */
+	    index = trace->ops[i].index;
+	    if ((trace->blocks[index] = malloc(trace->ops[i].size)) == NULL)
+		unix_error("malloc failed in eval_libc_speed");
+	    break;
+
+        case POOL_FREE: /* free */
+	    free(trace->blocks[trace->ops[i].index]);
+	    break;
+
+        case HALLOC: /* malloc */
+	    index = trace->ops[i].index;
+	    if ((trace->blocks[index] = malloc(trace->ops[i].size)) == NULL)
+		unix_error("malloc failed in eval_libc_speed");
+	    break;
+
+        case HFREE: /* free */
+	    free(trace->blocks[trace->ops[i].index]);
+	    break;
+
+        case HPIN: /* libc blocks never move */
+        case HUNPIN:
+	    break;
 	}
     }
 }
@@ -914,6 +1616,53 @@ static void eval_libc_speed(void *ptr)
  * Some miscellaneous helper routines
  ************************************/
 
+/*
+ * mm_alloc - allocates size bytes with mm_malloc, or with mm_malloc_hint
+ *     for requests that carry a lifetime hint
+ */
+static void *mm_alloc(int size, int life)
+{
+    if (life != MM_LIFE_SHORT)
+	return mm_malloc_hint(size, life);
+    return mm_malloc(size);
+}
+
+/*
+ * mm_resize - resizes the block p of oldsize bytes with mm_realloc, or
+ *     with -e grows it in place with mm_try_expand when it can
+ */
+static void *mm_resize(void *p, int oldsize, int size)
+{
+    if (try_expand && size > oldsize && mm_try_expand(p, size))
+	return p;
+    return mm_realloc(p, size);
+}
+
+/*
+ * mm_pool - returns the mm pool for the given pool of the trace,
+ *     creating it on its first use since the heap was emptied
+ */
+static mm_pool_t *mm_pool(trace_t *trace, int pool)
+{
+    if (mm_pools[pool] == NULL &&
+	(mm_pools[pool] = mm_pool_create(trace->pool_sizes[pool], 0)) == NULL)
+	app_error("mm_pool_create failed");
+    return mm_pools[pool];
+}
+
+/*
+ * mm_compact_step - takes one mm_compact step of at most COMPACTBUDGET
+ *     bytes, and returns how long it paused the trace in secs
+ */
+static double mm_compact_step(void)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    mm_compact(COMPACTBUDGET);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
 
 /*
  * printresults - prints a performance summary for some malloc package
@@ -922,22 +1671,64 @@ static void printresults(int n, stats_t *stats)
 {
     int i;
     double secs = 0;
+    double cold_secs = 0;
+    double copied = 0;
+    double quickhit = 0;
+    double probes = 0;
+    double zeroskip = 0;
+    double aligngap = 0;
     double ops = 0;
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s%7s %5s%8s%10s%6s%10s%10s%7s%8s%9s%9s", 
+	   "trace", " valid", "util", "ops", "secs", "Kops", "coldsecs", "rcopyKB",
+	   "qhit", "probes", "zskipKB", "agapKB");
+    if (count_dtlb)
+	printf("%9s", "dTLB/op");
+    if (count_cmiss)
+	printf("%9s", "miss/op");
+    if (compact)
+	printf("%9s%10s%9s", "cmpKB", "pause/us", "mean/us");
+    printf("\n");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f%10.6f%10.1f", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
-		   (stats[i].ops/1e3)/stats[i].secs);
+		   (stats[i].ops/1e3)/stats[i].secs,
+		   stats[i].cold_secs,
+		   stats[i].copied/1e3);
+	    if (stats[i].quickhit >= 0)
+		printf("%6.0f%%%8.1f%9.1f%9.1f", stats[i].quickhit*100.0,
+		       stats[i].probes, stats[i].zeroskip/1e3,
+		       stats[i].aligngap/1e3);
+	    else
+		printf("%7s%8s%9s%9s", "-", "-", "-", "-");
+	    if (count_dtlb && stats[i].dtlb >= 0)
+		printf("%9.3f", stats[i].dtlb/stats[i].ops);
+	    else if (count_dtlb)
+		printf("%9s", "n/a");
+	    if (count_cmiss && stats[i].cmiss >= 0)
+		printf("%9.3f", stats[i].cmiss/stats[i].ops);
+	    else if (count_cmiss)
+		printf("%9s", "n/a");
+	    if (compact && stats[i].pause >= 0)
+		printf("%9.0f%10.1f%9.2f", stats[i].compacted/1e3, stats[i].pause*1e6,
+		       stats[i].meanpause*1e6);
+	    else if (compact)
+		printf("%9s%10s%9s", "-", "-", "-");
+	    printf("\n");
 	    secs += stats[i].secs;
+	    cold_secs += stats[i].cold_secs;
+	    copied += stats[i].copied;
+	    quickhit += stats[i].quickhit;
+	    probes += stats[i].probes;
+	    zeroskip += stats[i].zeroskip;
+	    aligngap += stats[i].aligngap;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
 	}
@@ -954,12 +1745,18 @@ static void printresults(int n, stats_t *stats)
 
     /* Print the aggregate results for the set of traces */
     if (errors == 0) {
-	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	printf("%12s%5.0f%%%8.0f%10.6f%6.0f%10.6f%10.1f", 
 	       "Total       ",
 	       (util/n)*100.0,
 	       ops, 
 	       secs,
-	       (ops/1e3)/secs);
+	       (ops/1e3)/secs,
+	       cold_secs,
+	       copied/1e3);
+	if (quickhit >= 0)
+	    printf("%6.0f%%%8.1f%9.1f%9.1f", (quickhit/n)*100.0, probes/n,
+		   zeroskip/1e3, aligngap/1e3);
+	printf("\n");
     }
     else {
 	printf("%12s%6s%8s%10s%6s\n", 
@@ -1004,13 +1801,20 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValdcpseLC] [-f <file>] [-t <dir>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-c         Count cache misses per op (implies -v).\n");
+    fprintf(stderr, "\t-C         Compact handle blocks a step after each handle free.\n");
+    fprintf(stderr, "\t-d         Count dTLB misses per op (implies -v).\n");
+    fprintf(stderr, "\t-e         Try mm_try_expand before mm_realloc.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L         Learn lifetime hints for allocs from the trace.\n");
+    fprintf(stderr, "\t-p         Pre-fault the heap so runs avoid first-touch faults.\n");
+    fprintf(stderr, "\t-s         Free with mm_free_sized.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
@@ -10,28 +10,62 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "memlib.h"
+#include "pagemap.h"
 #include "config.h"
 
+/* A region of simulated VM that holds one heap */
+struct mem_region {
+    char *start_brk;  /* points to first byte of heap */
+    char *brk;        /* points to last byte of heap */
+    char *max_addr;   /* largest legal heap address */ 
+    char *clean_brk;  /* storage from here up has not been part of the heap since it was set up */
+    char *map_start;  /* start of the storage backing the heap */
+    size_t map_size;  /* bytes of storage at map_start */
+    mem_region_t *next; /* next region that is set up */
+    struct mem_shared *shared; /* bookkeeping in the segment of a shared region, else NULL */
+};
+
+/* 
+ * Kept at the start of the segment of a shared region, in the page
+ * before its heap. Each process maps the segment at an address of its
+ * own, so the brk fields are offsets from the start of the heap, and
+ * the copies in each process's mem_region are loaded from them.
+ */
+struct mem_shared {
+    size_t brk;       /* heap bytes in use */
+    size_t clean_brk; /* heap bytes ever in use */
+};
+
 /* private variables */
-static char *mem_start_brk;  /* points to first byte of heap */
-static char *mem_brk;        /* points to last byte of heap */
-static char *mem_max_addr;   /* largest legal heap address */ 
+static mem_region_t mem_default; /* the region set up by mem_init */
+static int mem_prefault = 0; /* if set, regions are pre-faulted when set up */
+static mem_region_t *mem_regions = NULL; /* all regions that are set up */
+
+static void region_init(mem_region_t *r, size_t maxsize);
+static void region_deinit(mem_region_t *r);
+static void region_load(mem_region_t *r);
+static void region_store(mem_region_t *r);
+
+/* 
+ * mem_set_prefault - select whether subsequent calls to mem_init and
+ *    mem_region_create pre-fault the heap storage, so that no later heap
+ *    access pays a first-touch page fault
+ */
+void mem_set_prefault(int prefault)
+{
+    mem_prefault = prefault;
+}
 
 /* 
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
-    /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
-	exit(1);
-    }
-
-    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
-    mem_brk = mem_start_brk;                  /* heap is empty initially */
+    region_init(&mem_default, MAX_HEAP);
 }
 
 /* 
@@ -39,15 +73,16 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    region_deinit(&mem_default);
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointer to make an empty heap,
+ *    forgetting whatever the page map recorded for the old one
  */
 void mem_reset_brk()
 {
-    mem_brk = mem_start_brk;
+    mem_region_reset(&mem_default);
 }
 
 /* 
@@ -57,15 +92,7 @@ void mem_reset_brk()
  */
 void *mem_sbrk(int incr) 
 {
-    char *old_brk = mem_brk;
-
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
-	errno = ENOMEM;
-	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
-	return (void *)-1;
-    }
-    mem_brk += incr;
-    return (void *)old_brk;
+    return mem_region_sbrk(&mem_default, incr);
 }
 
 /*
@@ -73,7 +100,7 @@ void *mem_sbrk(int incr)
  */
 void *mem_heap_lo()
 {
-    return (void *)mem_start_brk;
+    return mem_region_lo(&mem_default);
 }
 
 /* 
@@ -81,7 +108,18 @@ void *mem_heap_lo()
  */
 void *mem_heap_hi()
 {
-    return (void *)(mem_brk - 1);
+    return mem_region_hi(&mem_default);
+}
+
+/*
+ * mem_clean_lo - return the lowest address from which the storage has
+ *    never been part of the heap since mem_init, so that it still reads
+ *    as zero. Heaps reset by mem_reset_brk leave their old contents
+ *    below this address.
+ */
+void *mem_clean_lo()
+{
+    return mem_region_clean_lo(&mem_default);
 }
 
 /*
@@ -89,7 +127,314 @@ void *mem_heap_hi()
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    return mem_region_size(&mem_default);
+}
+
+/*
+ * mem_footprint() - returns the total size in bytes of the heaps of all
+ *    regions that are set up, the default one included
+ */
+size_t mem_footprint()
+{
+    mem_region_t *r;
+    size_t size = 0;
+
+    for (r = mem_regions; r != NULL; r = r->next)
+	size += mem_region_size(r);
+    return size;
+}
+
+/*
+ * region_init - set up r with room for a heap of up to maxsize bytes
+ */
+static void region_init(mem_region_t *r, size_t maxsize)
+{
+#if USE_THP
+    /* 
+     * Map one extra huge page so the heap can start on a huge page
+     * boundary, then ask the kernel to back it with transparent huge
+     * pages. If THP is unavailable the advice fails harmlessly and the
+     * heap is simply backed by base pages.
+     */
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_POPULATE
+    if (mem_prefault)
+	flags |= MAP_POPULATE;
+#endif
+    r->map_size = maxsize + THP_PAGESIZE;
+    r->map_start = mmap(NULL, r->map_size, PROT_READ | PROT_WRITE,
+			flags, -1, 0);
+    if (r->map_start == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
+	exit(1);
+    }
+    r->start_brk = (char *)(((unsigned long)r->map_start + THP_PAGESIZE - 1) &
+			    ~(unsigned long)(THP_PAGESIZE - 1));
+#ifdef MADV_HUGEPAGE
+    madvise(r->start_brk, maxsize, MADV_HUGEPAGE);
+#endif
+#else
+    /* 
+     * allocate the storage we will use to model the available VM, zeroed
+     * and page aligned like the fresh pages that sbrk or mmap hand out,
+     * wherever libc happens to place it
+     */
+    r->map_size = maxsize + mem_pagesize();
+    if ((r->map_start = (char *)calloc(1, r->map_size)) == NULL) {
+	fprintf(stderr, "mem_init_vm: malloc error\n");
+	exit(1);
+    }
+    r->start_brk = (char *)(((unsigned long)r->map_start + mem_pagesize() - 1) &
+			    ~(unsigned long)(mem_pagesize() - 1));
+#endif
+
+    r->max_addr = r->start_brk + maxsize;  /* max legal heap address */
+    r->brk = r->start_brk;                 /* heap is empty initially */
+    r->clean_brk = r->start_brk;           /* and none of it was ever used */
+    r->shared = NULL;
+    r->next = mem_regions;
+    mem_regions = r;
+
+    /* Touch one byte per page; this also covers systems without MAP_POPULATE */
+    if (mem_prefault) {
+	volatile char *p;
+	for (p = r->start_brk; p < r->max_addr; p += mem_pagesize())
+	    *p = 0;
+    }
+}
+
+/*
+ * region_deinit - free the storage backing r
+ */
+static void region_deinit(mem_region_t *r)
+{
+    mem_region_t **rp;
+
+    for (rp = &mem_regions; *rp != r; rp = &(*rp)->next)
+	;
+    *rp = r->next;
+    region_load(r);
+    if (r->shared) {
+	pagemap_clear(r->start_brk, r->max_addr - r->start_brk);
+	munmap(r->map_start, r->map_size);
+	return;
+    }
+    pagemap_clear(r->start_brk, r->brk - r->start_brk);
+#if USE_THP
+    munmap(r->map_start, r->map_size);
+#else
+    free(r->map_start);
+#endif
+}
+
+/*
+ * mem_region_create - create a region for a heap of up to maxsize
+ *    bytes, apart from the one mem_init sets up
+ */
+mem_region_t *mem_region_create(size_t maxsize)
+{
+    mem_region_t *r;
+
+    if ((r = malloc(sizeof(mem_region_t))) == NULL) {
+	fprintf(stderr, "mem_region_create: malloc error\n");
+	exit(1);
+    }
+    region_init(r, maxsize);
+    return r;
+}
+
+/*
+ * mem_region_open - create a region for a heap of up to maxsize bytes
+ *    in a new POSIX shared memory object of the given name, or if
+ *    maxsize is 0, open the region that another process created under
+ *    that name. Returns NULL if the object cannot be created, opened or
+ *    mapped.
+ *
+ *    Every process maps the object wherever mmap places it, and the brk
+ *    of the region moves for all of them at once. The caller keeps them
+ *    from moving it at the same time.
+ */
+mem_region_t *mem_region_open(const char *name, size_t maxsize)
+{
+    mem_region_t *r;
+    struct stat st;
+    size_t hdrsize = mem_pagesize(), mapsize;
+    int fd;
+
+    if (maxsize)
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    else
+	fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+	return NULL;
+    if (maxsize)
+	mapsize = ftruncate(fd, hdrsize + maxsize) < 0 ? 0 : hdrsize + maxsize;
+    else
+	mapsize = fstat(fd, &st) < 0 ? 0 : (size_t)st.st_size;
+    if (mapsize <= hdrsize || (r = malloc(sizeof(mem_region_t))) == NULL) {
+	close(fd);
+	if (maxsize)
+	    shm_unlink(name);
+	return NULL;
+    }
+
+    r->map_size = mapsize;
+    r->map_start = mmap(NULL, r->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r->map_start == MAP_FAILED) {
+	free(r);
+	if (maxsize)
+	    shm_unlink(name);
+	return NULL;
+    }
+    r->shared = (struct mem_shared *)r->map_start;  /* zero in a new object */
+    r->start_brk = r->map_start + hdrsize;
+    r->max_addr = r->map_start + r->map_size;
+    region_load(r);
+    r->next = mem_regions;
+    mem_regions = r;
+    return r;
+}
+
+/*
+ * mem_region_unlink - remove the name of a shared memory object made by
+ *    mem_region_open. The object goes away once no process maps it.
+ */
+int mem_region_unlink(const char *name)
+{
+    return shm_unlink(name);
+}
+
+/*
+ * mem_region_destroy - free r and the storage backing it, or for a
+ *    shared region, unmap it from this process
+ */
+void mem_region_destroy(mem_region_t *r)
+{
+    region_deinit(r);
+    free(r);
+}
+
+/*
+ * mem_region_reset - empty the heap of r in one step, forgetting
+ *    whatever the page map recorded for it. The heap of a shared
+ *    region is recorded once over the whole mapping, by each process
+ *    that maps it, so what is recorded for it stays.
+ */
+void mem_region_reset(mem_region_t *r)
+{
+    region_load(r);
+    if (r->shared == NULL)
+	pagemap_clear(r->start_brk, r->brk - r->start_brk);
+    r->brk = r->start_brk;
+    region_store(r);
+}
+
+/*
+ * mem_region_sbrk - mem_sbrk for the heap of r
+ */
+void *mem_region_sbrk(mem_region_t *r, int incr)
+{
+    char *old_brk;
+
+    region_load(r);
+    old_brk = r->brk;
+    if ( (incr < 0) || ((r->brk + incr) > r->max_addr)) {
+	errno = ENOMEM;
+	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
+	return (void *)-1;
+    }
+    r->brk += incr;
+    if (r->brk > r->clean_brk)
+	r->clean_brk = r->brk;
+    region_store(r);
+    return (void *)old_brk;
+}
+
+/*
+ * mem_region_lo, mem_region_hi, mem_region_clean_lo, mem_region_size -
+ *    mem_heap_lo, mem_heap_hi, mem_clean_lo and mem_heapsize for the
+ *    heap of r
+ */
+void *mem_region_lo(mem_region_t *r)
+{
+    return (void *)r->start_brk;
+}
+
+void *mem_region_hi(mem_region_t *r)
+{
+    region_load(r);
+    return (void *)(r->brk - 1);
+}
+
+void *mem_region_clean_lo(mem_region_t *r)
+{
+    region_load(r);
+    return (void *)r->clean_brk;
+}
+
+size_t mem_region_size(mem_region_t *r)
+{
+    region_load(r);
+    return (size_t)(r->brk - r->start_brk);
+}
+
+/*
+ * mem_region_maxsize - return the most bytes the heap of r can grow to
+ */
+size_t mem_region_maxsize(mem_region_t *r)
+{
+    return (size_t)(r->max_addr - r->start_brk);
+}
+
+/*
+ * mem_region_of - return the region whose heap holds the byte at p, or
+ *    NULL if none does
+ */
+mem_region_t *mem_region_of(void *p)
+{
+    mem_region_t *r;
+
+    for (r = mem_regions; r != NULL; r = r->next) {
+	region_load(r);
+	if ((char *)p >= r->start_brk && (char *)p < r->brk)
+	    return r;
+    }
+    return NULL;
+}
+
+/*
+ * region_load - bring the brk fields of r up to date with its segment
+ *    if it is shared, since another process may have moved them
+ */
+static void region_load(mem_region_t *r)
+{
+    if (r->shared) {
+	r->brk = r->start_brk + r->shared->brk;
+	r->clean_brk = r->start_brk + r->shared->clean_brk;
+    }
+}
+
+/*
+ * region_store - publish the brk fields of r to its segment if it is
+ *    shared
+ */
+static void region_store(mem_region_t *r)
+{
+    if (r->shared) {
+	r->shared->brk = r->brk - r->start_brk;
+	r->shared->clean_brk = r->clean_brk - r->start_brk;
+    }
+}
+
+/*
+ * mem_default_region - return the region set up by mem_init, which the
+ *    mem_xxx functions above work on
+ */
+mem_region_t *mem_default_region(void)
+{
+    return &mem_default;
 }
 
 /*
@@ -99,3 +444,18 @@ size_t mem_pagesize()
 {
     return (size_t)getpagesize();
 }
+
+/*
+ * mem_growsize() - returns the granularity in bytes in which the heap
+ *    should be extended. With USE_THP this is the huge page size, so
+ *    that the end of the heap never splits a huge page. Otherwise any
+ *    ALIGNMENT multiple is fine.
+ */
+size_t mem_growsize()
+{
+#if USE_THP
+    return (size_t)THP_PAGESIZE;
+#else
+    return (size_t)ALIGNMENT;
+#endif
+}
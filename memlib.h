@@ -1,11 +1,32 @@
 #include <unistd.h>
 
 void mem_init(void);               
+void mem_set_prefault(int prefault);
 void mem_deinit(void);
 void *mem_sbrk(int incr);
 void mem_reset_brk(void); 
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
+void *mem_clean_lo(void);
 size_t mem_heapsize(void);
+size_t mem_footprint(void);
 size_t mem_pagesize(void);
+size_t mem_growsize(void);
+
+/* Regions of their own for heaps other than the one above */
+typedef struct mem_region mem_region_t;
+
+mem_region_t *mem_region_create(size_t maxsize);
+mem_region_t *mem_region_open(const char *name, size_t maxsize);  /* shared memory; 0 opens */
+int mem_region_unlink(const char *name);
+void mem_region_destroy(mem_region_t *r);
+void mem_region_reset(mem_region_t *r);
+void *mem_region_sbrk(mem_region_t *r, int incr);
+void *mem_region_lo(mem_region_t *r);
+void *mem_region_hi(mem_region_t *r);
+void *mem_region_clean_lo(mem_region_t *r);
+size_t mem_region_size(mem_region_t *r);
+size_t mem_region_maxsize(mem_region_t *r);
+mem_region_t *mem_default_region(void);
+mem_region_t *mem_region_of(void *p);
 
@@ -20,6 +20,13 @@
  *  ---------              | FOOTER  |
  *                          ---------
  * 
+ * Every header also records whether the block before it is allocated (PREVALLOC), so coalesce
+ * never has to read the footer of an allocated block.
+ *
+ * The footer of a free block is tagged ZEROED while its payload, apart from the free list links at
+ * its start, has never been written since the heap grew over it. mm_calloc skips clearing blocks
+ * carved from such free blocks, which in practice are the fresh parts of the wilderness.
+ *
  * Free list organization:
  * Free blocks on the heap are organized using an explicit free list with the head of the list being 
  * pointed to by a pointer free_listp (see diagram below in mm_init). Each free block contains two 
@@ -34,6 +41,68 @@
  * For more information on how the free list is modified, see the functions 'remove_freeblock' and
  * 'coalesce'.
  *
+ * With NEXTFIT set to 1 the search is next fit instead of first fit: find_fit starts where the
+ * previous search succeeded (the rover) and wraps around to the front of the list. Removing the
+ * block under the rover moves the rover on to the next free block, so it always points into the list.
+ *
+ * With FITINDEX set to 1 there is no free list to walk. Free blocks are kept in a dense index
+ * instead: per power-of-two size class, an array of block sizes and a parallel array of heap
+ * offsets that grow as the class fills, with each free block holding the position of its entry in
+ * its class in place of its NEXT pointer.
+ * find_fit only compares the sizes of the smallest class that may hold a fit, several at a time
+ * with SSE2/AVX2 where the compiler targets them; in any larger class the first entry fits. The
+ * index takes the place of the list, so NEXTFIT and ADDRORDER have no effect with it.
+ *
+ * With ADDRORDER set to 1 the free list is kept in address order instead, which makes first fit
+ * pick the lowest block that fits. To find a block's place in O(log n), the list is the bottom
+ * level of a skip list: a free block with room for them carries SKIPLEVELS forward pointers or
+ * fewer after its PREV pointer. A block's height is a hash of its address, capped by its size.
+ *
+ * Small objects:
+ * Requests of SLABMAX bytes or less are served from slabs instead. A slab is an ordinary allocated
+ * block of SLABSIZE bytes whose payload starts on a SLABSIZE boundary, so it fills exactly one
+ * slab page. Each slab holds objects of a single size class, which carry no header or footer; a
+ * bitmap at the start of the slab tracks its free slots. Each slab page is recorded in the page map
+ * (pagemap.h) as a PM_SLAB page with its size class, which lets mm_free and mm_realloc tell slab
+ * objects from ordinary blocks with a few loads. Slabs with free slots are kept on a list per size class.
+ * The first object sits just far enough past the bitmap that every object is aligned to the largest
+ * power of two up to SLABALIGN that divides its size, which mm_memalign relies on.
+ *
+ * Wilderness:
+ * The free block at the end of the heap, if any, is the wilderness. It is the only block that can
+ * grow without moving anything, so find_fit passes it over unless no other block fits. When the
+ * heap has to grow, it grows by the shortfall past the wilderness plus a chunk of 1/WILDDIV of the
+ * heap size (at most WILDMAX bytes), which becomes the new wilderness. The chunk keeps the number
+ * of extensions small while heap growth stays proportional to the live heap.
+ *
+ * Quick lists:
+ * Freed blocks of QUICKMAX bytes or less are not coalesced right away. They stay marked allocated
+ * and are pushed on a LIFO quick list holding blocks of exactly their size, so that the next
+ * malloc of that size pops one without searching, splitting, or coalescing. The quick lists are
+ * flushed (every block in them is freed and coalesced for real) once they hold QUICKCOUNT blocks,
+ * and whenever no free block fits a request, before the heap is grown.
+ *
+ * Heaps:
+ * All of the state above belongs to one heap (struct mm_heap), and the code works on whichever
+ * heap the heap pointer names. mm_init sets up the default heap in the memlib heap. mm_heap_create
+ * sets up more, each in a memlib region of its own, for memory that is thrown away all at once:
+ * mm_heap_reset empties a heap without visiting its blocks. The page map records each heap's id
+ * as the arena of its pages, so mm_free and mm_realloc find the heap of any block. mm_malloc_hint
+ * keeps blocks expected to live long in heaps of their own, apart from the default heap's churn.
+ *
+ * Handles:
+ * mm_halloc hands out relocatable blocks by handle, from a heap of their own. The caller reaches a
+ * block by pinning it with mm_hpin, and mm_compact slides the blocks that are not pinned down over
+ * the free blocks before them, a bounded step at a time, so that their free space gathers in the
+ * wilderness where any request can use it.
+ *
+ * Shared heaps:
+ * mm_heap_create_shared makes a heap in named POSIX shared memory, with its state at the start,
+ * which other processes map with mm_heap_attach and allocate from and free into under a lock in
+ * the state. Links are heap offsets already, so a block is handed over as its offset from the
+ * heap (mm_heap_offset), which every process turns back into a pointer of its own mapping. Each
+ * process records the whole mapping in its page map, so mm_free and the like find the heap.
+ *
  *
  * Authors:
  * (1) Jonathan Whitaker
@@ -44,9 +113,13 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <stddef.h>
+#include <sched.h>
 
 #include "mm.h"
 #include "memlib.h"
+#include "pagemap.h"
+#include "config.h"
 
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
@@ -75,42 +148,598 @@ team_t team = {
 #define MINBLOCKSIZE      16        /* Minmum size for a free block, includes 4 bytes for header/footer
                                        and space within the payload for two pointers to the prev and next
                                        free blocks */
+#define SLABSIZE          PM_PAGESIZE  // Size in bytes of a slab (one page of the page map)
+#define SLABMAX           64        // Largest request served from a slab
+#define NSLABCLASSES      (SLABMAX / ALIGNMENT)   // Slab size classes: ALIGNMENT, 2*ALIGNMENT, ..., SLABMAX
+#define SLABMAPWORDS      ((SLABSIZE / ALIGNMENT + 31) / 32)  // Bitmap words for the most slots a slab can hold
+#define SLABALIGN         64        // Slab objects are aligned to the largest power of two up to this dividing their size
+#define POOLCHUNK         PM_PAGESIZE  // Smallest chunk a pool takes from the heap
+#define POOLMINOBJS       16        // Fewest objects a pool chunk holds
+#define OVERHEAD          DSIZE     // Bytes of an allocated block outside its payload
+#define PREVALLOC         0x4       // Header bit set if the previous block is allocated
+#define GROWN             0x2       // Header tag of an allocated block that realloc has grown before
+#define RESERVED          0x2       // Header tag of a free block held as slack for the block before it
+#define ZEROED            0x4       // Footer tag of a free block whose payload is zero past its links
+#define LINKBYTES         (((ADDRORDER && !FITINDEX) ? SKIPLEVELS + 1 : 2) * WSIZE)  // Most payload bytes
+                                                                                     // links can take
+#define WILDDIV           64        // Heap growth beyond the shortfall, as a fraction of the heap size
+#define WILDMAX           (1<<16)   // Most heap growth beyond the shortfall, in bytes
+#define NEXTFIT           0         // Set to 1 to search the free list by next fit instead of first fit
+#define FITINDEX          0         // Set to 1 to search a dense per-class index instead of the free list
+#define FITCLASSES        24        // Index size classes: [MINBLOCKSIZE << c, MINBLOCKSIZE << (c+1))
+#define FITMIN            64        // Entries an index class first gets room for in a private heap
+#define ADDRORDER         0         // Set to 1 to keep the free list in address order instead of LIFO
+#define SKIPLEVELS        16        // Most levels of the address-ordered skip list
+#define SPLITHIGH         256       // Smallest block placed at the high end of a free block it splits
+#define QUICKMAX          1024      // Largest block size kept on a quick list
+#define NQUICK            (QUICKMAX / ALIGNMENT + 1)  // Quick lists, indexed by block size / ALIGNMENT
+#define QUICKCOUNT        256       // Number of blocks the quick lists hold before they are flushed
+#define MAXHEAPS          256       // Most heaps at once, counting the default and lifetime heaps
+#define ATTACHWAIT        1000      // Milliseconds mm_heap_attach waits for a heap being set up
+#define NLIFETIMES        3         // Lifetime classes of mm_malloc_hint, MM_LIFE_SHORT to MM_LIFE_LONG
+#define HANDLEMIN         64        // Entries of the handle table when it is first made
+#define COMPACTDIV        8         // mm_compact starts a pass once holes make up this fraction of its heap
+#define SIZECHECK         0         // Set to 1 to check the size passed to mm_free_sized against the block
 
 // MACROS
 /* NOTE: Most of these macros came from the text book on Page 857 (Fig. 9.43). We added the
- * NEXT_FREE and PREV_FREE macros to traverse the free list */
+ * NEXT_FREE and PREV_FREE macros to traverse the free list. Headers, footers and free list links
+ * are all one 4-byte word, on 32-bit and 64-bit builds alike. */
 #define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~0x7)
+#define ROUNDUP(x, n) ((((x) + (n) - 1) / (n)) * (n))
+#define SLACK(asize) ALIGN((asize) / 2)     // Room reserved behind a block that keeps growing
 #define MAX(x, y) ((x) > (y)? (x) : (y))
+#define MIN(x, y) ((x) < (y)? (x) : (y))
+#define ASIZE(size) MAX(ALIGN((size) + OVERHEAD), MINBLOCKSIZE)   // Block size for a payload of size bytes
 #define PACK(size, alloc) ((size) | (alloc))
-#define GET(p)        (*(size_t *)(p))
-#define PUT(p, val)   (*(size_t *)(p) = (val))
-#define GET_SIZE(p)  (GET(p) & ~0x1)
+#define GET(p)        (*(unsigned int *)(p))
+#define PUT(p, val)   (*(unsigned int *)(p) = (val))
+#define GET_SIZE(p)  (GET(p) & ~0x7)
 #define GET_ALLOC(p) (GET(p) & 0x1)
+#define GET_TAG(p)   (GET(p) & 0x2)
+#define SET_TAG(p)   (PUT(p, GET(p) | 0x2))
+#define GET_PREV_ALLOC(p) (GET(p) & PREVALLOC)
+#define IS_ZEROED(bp)  (GET(FTRP(bp)) & ZEROED)
+#define SET_ZEROED(bp) (PUT(FTRP(bp), GET(FTRP(bp)) | ZEROED))
 #define HDRP(bp)     ((void *)(bp) - WSIZE)
 #define FTRP(bp)     ((void *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
 
 #define NEXT_BLKP(bp) ((void *)(bp) + GET_SIZE(HDRP(bp)))
 #define PREV_BLKP(bp) ((void *)(bp) - GET_SIZE(HDRP(bp) - WSIZE))
-#define NEXT_FREE(bp)(*(void **)(bp))
-#define PREV_FREE(bp)(*(void **)(bp + WSIZE))
+#define SLAB_CLASS(size) (ALIGN(size) / ALIGNMENT - 1)
+
+/* A link to a block is stored as the 32-bit offset of its payload from the start of the heap, or
+ * 0 for NULL (no payload starts there), so that a link takes one word even where a pointer takes
+ * two. Links are only read and written through GET_LINK and PUT_LINK. */
+#define GET_LINK(p)      (GET(p) ? (void *)(heap->heap_listp + GET(p)) : NULL)
+#define PUT_LINK(p, ptr) PUT(p, (ptr) ? (unsigned int)((char *)(ptr) - heap->heap_listp) : 0)
+
+#define NEXT_FREE(bp)            GET_LINK(bp)
+#define PREV_FREE(bp)            GET_LINK((void *)(bp) + WSIZE)
+#define SKIP_NEXT(bp, i)         GET_LINK((void *)(bp) + ((i) + 1) * WSIZE)  // Level i > 0 forward link
+#define SET_NEXT_FREE(bp, ptr)   PUT_LINK(bp, ptr)
+#define SET_PREV_FREE(bp, ptr)   PUT_LINK((void *)(bp) + WSIZE, ptr)
+#define SET_SKIP_NEXT(bp, i, ptr) PUT_LINK((void *)(bp) + ((i) + 1) * WSIZE, ptr)
 
 
 // PROTOTYPES
+static int heap_init(void);
+static void shared_enter(mm_heap_t *h);
+static void shared_leave(mm_heap_t *h);
+static size_t shared_state_size(size_t size);
+static int shared_register(mm_heap_t *h);
+static inline mm_heap_t *heap_of(void *bp);
+static void *alloc_block(size_t size, int *zeroed);
+static void free_block(void *bp);
+#if SIZECHECK
+static void check_size(void *bp, size_t size);
+#endif
 static void *extend_heap(size_t words);
-static void *find_fit(size_t size);
+static void *find_fit(size_t size, size_t align);
+static void *scan_fit(void *bp, void *stop, size_t size, size_t align, void **wilderness, void **reserved);
+#if FITINDEX
+static void *index_fit(size_t size);
+static size_t index_size(size_t size);
+static void index_layout(char *p, size_t size);
+static void index_grow(int c);
+#endif
 static void *coalesce(void *bp);
 static void place(void *bp, size_t asize);
+static void put_block(void *bp, size_t size, int alloc, int prev_alloc);
+static void *place_by_size(void *bp, size_t asize);
 static void remove_freeblock(void *bp);
+static void shrink_block(void *bp, size_t asize);
+static int grow_block(void *bp, size_t asize);
+static void *slide_block(void *bp, size_t asize);
+static void reserve_slack(void *bp);
+static void insert_freeblock(void *bp);
+#if ADDRORDER && !FITINDEX
+static int skip_height(void *bp);
+static void skip_find(void *bp, void **preds);
+#endif
+static void *place_aligned(size_t asize, size_t align, size_t *gapp);
+static size_t align_gap(void *bp, size_t align);
+static void *slab_alloc(size_t size);
+static void quick_push(void *bp, size_t size);
+static int ptr_cmp(const void *a, const void *b);
+static void quick_flush(void);
+static size_t wilderness_size(void);
+static void slab_free(void *bp);
+static int slab_objsize(void *bp);
 // static int mm_check();
 
 
-// Private variables represeneting the heap and free list within the heap
-static char *heap_listp = 0;  /* Points to the start of the heap */
-static char *free_listp = 0;  /* Poitns to the frist free block */
+/* A slab page. The header sits at the start of the payload of the slab's block, and the objects
+ * follow it. A set bit in the bitmap marks a free slot. */
+typedef struct slab {
+  struct slab *next;                   /* Next slab of this size class with free slots */
+  struct slab *prev;                   /* Previous slab of this size class with free slots */
+  unsigned short objsize;              /* Size in bytes of each object */
+  unsigned short nslots;               /* Number of objects the slab holds */
+  unsigned short nfree;                /* Number of free slots */
+  unsigned short first;                /* Offset of the first object from the slab */
+  unsigned int bitmap[SLABMAPWORDS];   /* Free slot map, bit i of word i/32 is slot i */
+} slab_t;
+
+#define SLAB_HDRSIZE ALIGN(sizeof(slab_t))
+
+/* A chunk of a fixed-size object pool, laid out like a slab: the header sits at the start of the
+ * payload of the chunk's block and the objects follow it. Each free object holds the address of
+ * the next free object of its chunk. Objects past the ones handed out so far are not on that list. */
+typedef struct pool_chunk {
+  struct pool_chunk *next;             /* Next chunk on the same list of the pool */
+  struct pool_chunk *prev;             /* Previous chunk on the same list of the pool */
+  void *free;                          /* First free object that has been handed out before */
+  unsigned int nfree;                  /* Number of free objects, fresh ones included */
+  unsigned int nfresh;                 /* Number of objects at the end never handed out */
+} pool_chunk_t;
+
+/* A fixed-size object pool. It lives in an ordinary block of the heap its chunks come from. */
+struct mm_pool {
+  size_t objsize;                      /* Size in bytes of each object, a multiple of its alignment */
+  size_t first;                        /* Offset of the first object from its chunk */
+  size_t chunksize;                    /* Block size of each chunk */
+  size_t chunkalign;                   /* Alignment of each chunk */
+  unsigned int nobjs;                  /* Number of objects a chunk holds */
+  pool_chunk_t *chunks;                /* Chunks with free objects */
+  pool_chunk_t *full;                  /* Chunks without */
+};
+
+static pool_chunk_t *pool_grow(mm_pool_t *pool);
+static void pool_link(pool_chunk_t **list, pool_chunk_t *chunk);
+static void pool_unlink(pool_chunk_t **list, pool_chunk_t *chunk);
+static void pool_release(mm_pool_t *pool, pool_chunk_t *chunk);
+
+/* An entry of the handle table. The payload of a handle's block starts with the handle, and the
+ * caller's data follows DSIZE bytes in, so that compaction can tell whose block it moves. */
+typedef struct {
+  char *bp;                            /* Payload of the handle's block, NULL while unused */
+  unsigned int pins;                   /* Pin count, or the next unused entry while unused */
+} handle_t;
+
+/* The state of one heap. mm_init sets up the default heap, which mm_malloc and the other mm_xxx
+ * functions work on. mm_heap_create makes more, each growing in a memlib region of its own, and
+ * the mm_heap_xxx functions point heap at the one they are given while they run. */
+struct mm_heap {
+  mem_region_t *region;         /* Storage the heap grows in */
+  int id;                       /* Arena recorded in the page map for the heap's pages */
+  char *heap_listp;             /* Points to the start of the heap */
+  char *end;                    /* Points just past the end of the heap */
+  char *free_listp;             /* Points to the first free block */
+  void *rover;                  /* Where the next fit search starts (NEXTFIT only) */
+#if FITINDEX
+  unsigned int *fit_sizes[FITCLASSES];  /* Size of each indexed block, per class */
+  unsigned int *fit_offs[FITCLASSES];   /* Heap offset of each indexed block, per class */
+  unsigned int fit_room[FITCLASSES];    /* Entries each class has room for */
+  unsigned int fit_count[FITCLASSES];   /* Entries in use in each class */
+  unsigned int fit_classes;             /* Bit c is set if class c has entries */
+#endif
+#if ADDRORDER && !FITINDEX
+  void *skip_heads[SKIPLEVELS]; /* First block of each skip list level, skip_end if none */
+  void *skip_end;               /* Block that ends every level, the list's sentinel */
+#endif
+  slab_t *slab_lists[NSLABCLASSES];  /* Slabs with free slots, per size class */
+  void *quick_lists[NQUICK];    /* Freed blocks of each size awaiting coalescing, LIFO */
+  int quick_count;              /* Number of blocks on the quick lists */
+  int noslabs;                  /* Set for heaps that make no slabs: the heap of mm_halloc, whose blocks
+                                   all carry handles, and shared heaps */
+  int shared;                   /* Set for a heap in shared memory, made by mm_heap_create_shared */
+  int lock;                     /* Held by the process working on a shared heap */
+  int ready;                    /* Set to 1 once a shared heap is set up, or -1 if it cannot be */
+  char *base;                   /* Address of a shared heap in the process that last worked on it */
+  size_t statesize;             /* Bytes at the start of a shared heap's region that its state takes */
+  mm_counters_t counters;       /* Event counters since the heap was set up, see mm_counters */
+};
+
+static mm_heap_t default_heap;            /* The heap mm_init sets up */
+static mm_heap_t *heap = &default_heap;   /* The heap being worked on */
+static mm_heap_t *heaps[MAXHEAPS] = {&default_heap};  /* Every heap, by id (its arena) */
+static mm_heap_t *life_heaps[NLIFETIMES];  /* Heap of each lifetime class past MM_LIFE_SHORT */
+
+/* The handles of mm_halloc. The table lives in the default heap, and entry 0 is never used. */
+static struct {
+  mm_heap_t *heap;              /* Heap of the handles' blocks, made on first use */
+  handle_t *table;              /* Entry of each handle */
+  unsigned int size;            /* Entries the table has room for */
+  unsigned int count;           /* Entries used so far, entry 0 included */
+  unsigned int free;            /* First unused entry below count, 0 if none */
+  unsigned int cursor;          /* Handle of the block where mm_compact goes on, 0 for the start */
+  size_t live;                  /* Bytes of the handles' blocks */
+} handles = {NULL, NULL, 0, 1, 0, 0, 0};
+
+
+/*
+ * mm_init - Initializes the default heap, which grows in the memlib heap, and makes it the
+ * heap the mm_xxx functions work on. The heaps of the lifetime classes and of the handles are
+ * emptied along with it, and every handle goes away.
+ */
+int mm_init(void)
+{
+  int c;
+
+  for (c = 1; c < NLIFETIMES; c++)
+    if (life_heaps[c] && mm_heap_reset(life_heaps[c]) < 0)
+      return -1;
+  if (handles.heap && mm_heap_reset(handles.heap) < 0)
+    return -1;
+  handles.table = NULL;
+  handles.size = handles.free = handles.cursor = 0;
+  handles.count = 1;
+  handles.live = 0;
+  heap = &default_heap;
+  heap->region = mem_default_region();
+  return heap_init();
+}
+
+/*
+ * mm_heap_create - Creates a heap apart from the default heap, in a memlib region of its own
+ * with room for MAX_HEAP bytes, or returns NULL if it cannot be set up or MAXHEAPS heaps exist.
+ *
+ * Blocks are allocated from it with mm_heap_malloc. All of them can be thrown away at once by
+ * mm_heap_reset. Every page of the heap is recorded in the page map with the heap's id as its
+ * arena, so mm_free, mm_realloc and the like work on its blocks from any heap.
+ */
+mm_heap_t *mm_heap_create(void)
+{
+  mm_heap_t *h, *saved = heap;
+  int id, rc;
+
+  // Id 0 is the default heap
+  for (id = 1; id < MAXHEAPS && heaps[id]; id++)
+    ;
+  if (id == MAXHEAPS || (h = calloc(1, sizeof(mm_heap_t))) == NULL)
+    return NULL;
+  h->region = mem_region_create(MAX_HEAP);
+  h->id = id;
+  heaps[id] = h;
+
+  heap = h;
+  rc = heap_init();
+  heap = saved;
+  if (rc < 0) {
+    mm_heap_destroy(h);
+    return NULL;
+  }
+  return h;
+}
+
+/*
+ * mm_heap_malloc - mm_malloc for the heap h.
+ */
+void *mm_heap_malloc(mm_heap_t *h, size_t size)
+{
+  mm_heap_t *saved = heap;
+  void *bp;
+
+  heap = h;
+  if (h->shared)
+    shared_enter(h);
+  bp = mm_malloc(size);
+  if (h->shared)
+    shared_leave(h);
+  heap = saved;
+  return bp;
+}
+
+/*
+ * mm_heap_free - mm_free for the block bp of the heap h.
+ */
+void mm_heap_free(mm_heap_t *h, void *bp)
+{
+  mm_heap_t *saved = heap;
+
+  heap = h;
+  if (h->shared)
+    shared_enter(h);
+  mm_free(bp);
+  if (h->shared)
+    shared_leave(h);
+  heap = saved;
+}
+
+/*
+ * mm_heap_realloc - mm_realloc for the block ptr of the heap h, which a moved block stays in.
+ */
+void *mm_heap_realloc(mm_heap_t *h, void *ptr, size_t size)
+{
+  mm_heap_t *saved = heap;
+  void *bp;
+
+  heap = h;
+  if (h->shared)
+    shared_enter(h);
+  bp = mm_realloc(ptr, size);
+  if (h->shared)
+    shared_leave(h);
+  heap = saved;
+  return bp;
+}
+
+/*
+ * mm_heap_reset - Frees every block of the heap h at once, or of the default heap if h is NULL,
+ * and leaves it empty as it was set up. Returns -1 if it cannot be set up again, 0 otherwise.
+ *
+ * No block is visited: the heap's region is cut back to empty, the page map entries of its
+ * pages are cleared and the allocator state of the heap starts over.
+ */
+int mm_heap_reset(mm_heap_t *h)
+{
+  mm_heap_t *saved = heap;
+  int rc;
+
+  if (h == NULL) {
+    mem_reset_brk();
+    return mm_init();
+  }
+  heap = h;
+  if (h->shared) {
+    // The heap state stays where it is, at the start of the region
+    shared_enter(h);
+    mem_region_reset(h->region);
+    mem_region_sbrk(h->region, h->statesize);
+    rc = heap_init();
+    shared_leave(h);
+  } else {
+    mem_region_reset(h->region);
+    rc = heap_init();
+  }
+  heap = saved;
+  return rc;
+}
+
+/*
+ * mm_heap_destroy - Frees the heap h made by mm_heap_create and the storage it grew in. A shared
+ * heap is only unmapped from this process, and stays for the others until mm_heap_unlink.
+ */
+void mm_heap_destroy(mm_heap_t *h)
+{
+  int id;
+
+  if (h->shared) {
+    // The id this process recorded the heap under is its own, and not kept in the shared state
+    for (id = 1; id < MAXHEAPS && heaps[id] != h; id++)
+      ;
+    if (id < MAXHEAPS)
+      heaps[id] = NULL;
+    mem_region_destroy(mem_region_of(h));
+    return;
+  }
+  heaps[h->id] = NULL;
+  mem_region_destroy(h->region);
+#if FITINDEX
+  int c;
+  for (c = 0; c < FITCLASSES; c++) {
+    free(h->fit_sizes[c]);
+    free(h->fit_offs[c]);
+  }
+#endif
+  free(h);
+}
+
+/*
+ * mm_heap_create_shared - Creates a heap with room for size bytes in a new POSIX shared memory
+ * object of the given name, which other processes can then map with mm_heap_attach. Returns NULL
+ * if the object cannot be made, for instance because the name is taken.
+ *
+ * The heap state sits at the start of the object, and the heap handle every process gets is
+ * where that process mapped it. All the links within the heap are offsets, so only the few
+ * pointers of the heap state have to change for a process that maps it elsewhere: shared_enter
+ * moves them by the difference as the process takes the heap's lock, a spinlock in the state.
+ * Shared heaps make no slabs, whose links are pointers and whose pages only the page map of the
+ * process that made them would know. Nor do they record the pages they grow over: every process
+ * records the whole mapping once, under an id of its own (shared_register), and the heap's id in
+ * the state stays 0.
+ */
+mm_heap_t *mm_heap_create_shared(const char *name, size_t size)
+{
+  mm_heap_t *h, *saved = heap;
+  size_t statesize = shared_state_size(size);
+  mem_region_t *r;
+  int rc;
+
+  if ((r = mem_region_open(name, statesize + size)) == NULL)
+    return NULL;
+  h = mem_region_lo(r);
+  if (mem_region_sbrk(r, statesize) == (void *)-1)
+    rc = -1;
+  else {
+    h->region = r;
+    h->noslabs = h->shared = 1;
+    h->base = (char *)h;
+    h->statesize = statesize;
+    heap = h;
+#if FITINDEX
+    index_layout((char *)h + ALIGN(sizeof(mm_heap_t)), size);
+#endif
+    rc = heap_init();
+    heap = saved;
+  }
+  if (rc == 0)
+    rc = shared_register(h);
+
+  // Processes that attached meanwhile wait for this before they touch the heap
+  __atomic_store_n(&h->ready, rc < 0 ? -1 : 1, __ATOMIC_RELEASE);
+  if (rc < 0) {
+    mem_region_destroy(r);
+    mem_region_unlink(name);
+    return NULL;
+  }
+  return h;
+}
+
+/*
+ * mm_heap_attach - Maps the shared heap made under the given name by mm_heap_create_shared into
+ * this process, and returns its handle here, or NULL if there is no such heap. A heap that is
+ * still being set up is waited for, up to ATTACHWAIT milliseconds, in case its creator died or
+ * gave up on it.
+ */
+mm_heap_t *mm_heap_attach(const char *name)
+{
+  mem_region_t *r;
+  mm_heap_t *h;
+  int ready, ms;
+
+  if ((r = mem_region_open(name, 0)) == NULL)
+    return NULL;
+  h = mem_region_lo(r);
+  for (ms = 0; (ready = __atomic_load_n(&h->ready, __ATOMIC_ACQUIRE)) == 0 && ms < ATTACHWAIT; ms++)
+    usleep(1000);
+  if (ready <= 0 || shared_register(h) < 0) {
+    mem_region_destroy(r);
+    return NULL;
+  }
+  return h;
+}
+
+/*
+ * mm_heap_unlink - Removes the name of a shared heap. Its memory goes away once every process
+ * has unmapped it with mm_heap_destroy or exited.
+ */
+int mm_heap_unlink(const char *name)
+{
+  return mem_region_unlink(name);
+}
+
+/*
+ * mm_heap_offset, mm_heap_ptr - Turn a block of the shared heap h into an offset that names it
+ * in every process mapping the heap, and back, so blocks are handed over without copying.
+ */
+size_t mm_heap_offset(mm_heap_t *h, void *bp)
+{
+  return (size_t)((char *)bp - (char *)h);
+}
+
+void *mm_heap_ptr(mm_heap_t *h, size_t offset)
+{
+  return (char *)h + offset;
+}
+
+/*
+ * shared_state_size - Returns the bytes the state of a shared heap of up to size bytes takes at
+ * the start of its region, its index included.
+ */
+static size_t shared_state_size(size_t size)
+{
+#if FITINDEX
+  return ALIGN(sizeof(mm_heap_t)) + index_size(size);
+#else
+  return ALIGN(sizeof(mm_heap_t));
+#endif
+}
 
+/*
+ * shared_register - Records the shared heap h in this process under an id of its own, over the
+ * whole of its mapping, so that heap_of finds it for any of its blocks. Returns -1 if MAXHEAPS
+ * heaps exist, 0 otherwise.
+ */
+static int shared_register(mm_heap_t *h)
+{
+  mem_region_t *r = mem_region_of(h);
+  int id;
+
+  for (id = 1; id < MAXHEAPS && heaps[id]; id++)
+    ;
+  if (id == MAXHEAPS)
+    return -1;
+  heaps[id] = h;
+  pagemap_set(mem_region_lo(r), mem_region_maxsize(r), PM_NONE, 0, id);
+  return 0;
+}
+
+/*
+ * rebase - Returns the pointer p of a shared heap's state moved by delta bytes, or NULL if NULL.
+ */
+static inline void *rebase(void *p, ptrdiff_t delta)
+{
+  return p ? (char *)p + delta : NULL;
+}
+
+/*
+ * shared_enter - Takes the lock of the shared heap h for this process, and moves the pointers of
+ * its state over to this process's mapping if the process before mapped it elsewhere.
+ */
+static void shared_enter(mm_heap_t *h)
+{
+  ptrdiff_t delta;
+  int i;
+
+  while (__atomic_exchange_n(&h->lock, 1, __ATOMIC_ACQUIRE))
+    while (__atomic_load_n(&h->lock, __ATOMIC_RELAXED))
+      sched_yield();
+
+  // The region is this process's own record of the mapping
+  h->region = mem_region_of(h);
+  if ((delta = (char *)h - h->base) == 0)
+    return;
+  h->heap_listp = rebase(h->heap_listp, delta);
+  h->end = rebase(h->end, delta);
+  h->free_listp = rebase(h->free_listp, delta);
+  h->rover = rebase(h->rover, delta);
+#if ADDRORDER && !FITINDEX
+  for (i = 0; i < SKIPLEVELS; i++)
+    h->skip_heads[i] = rebase(h->skip_heads[i], delta);
+  h->skip_end = rebase(h->skip_end, delta);
+#endif
+  for (i = 0; i < NQUICK; i++)
+    h->quick_lists[i] = rebase(h->quick_lists[i], delta);
+#if FITINDEX
+  for (i = 0; i < FITCLASSES; i++) {
+    h->fit_sizes[i] = rebase(h->fit_sizes[i], delta);
+    h->fit_offs[i] = rebase(h->fit_offs[i], delta);
+  }
+#endif
+  h->base = (char *)h;
+}
+
+/*
+ * shared_leave - Releases the lock of the shared heap h.
+ */
+static void shared_leave(mm_heap_t *h)
+{
+  __atomic_store_n(&h->lock, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * mm_malloc_hint - Allocates size bytes like mm_malloc, in the heap kept for blocks of the given
+ * expected lifetime, from MM_LIFE_SHORT to MM_LIFE_LONG (mm.h). Returns NULL if out of memory.
+ *
+ * Short lived blocks go to the default heap. Each longer class has a heap of its own, created
+ * on first use, so that blocks that stay do not pin the free space left among blocks that come
+ * and go. The blocks are freed or resized by the usual functions, which find their heap.
+ */
+void *mm_malloc_hint(size_t size, int lifetime)
+{
+  if (lifetime <= MM_LIFE_SHORT)
+    return mm_malloc(size);
+  if (lifetime >= NLIFETIMES)
+    lifetime = NLIFETIMES - 1;
+  if (life_heaps[lifetime] == NULL && (life_heaps[lifetime] = mm_heap_create()) == NULL)
+    return NULL;
+  return mm_heap_malloc(life_heaps[lifetime], size);
+}
 
 /* 
- * mm_init - Initializes the heap like that shown below.
+ * heap_init - Sets up heap as an empty heap in its region, like that shown below.
  *  ____________                                                    _____________
  * |  PROLOGUE  |                8+ bytes or 2 ptrs                |   EPILOGUE  |
  * |------------|------------|-----------|------------|------------|-------------|
@@ -119,23 +748,46 @@ static char *free_listp = 0;  /* Poitns to the frist free block */
  * ^            ^            ^       
  * heap_listp   free_listp   bp 
  */
-int mm_init(void)
+static int heap_init(void)
 {
   // Initialize the heap with freelist prologue/epilogoue and space for the
   // initial free block. (32 bytes total)
-  if ((heap_listp = mem_sbrk(INITSIZE + MINBLOCKSIZE)) == (void *)-1)
+  if ((heap->heap_listp = mem_region_sbrk(heap->region, INITSIZE + MINBLOCKSIZE)) == (void *)-1)
       return -1; 
-  PUT(heap_listp,             PACK(MINBLOCKSIZE, 1));           // Prologue header 
-  PUT(heap_listp +    WSIZE,  PACK(MINBLOCKSIZE, 0));           // Free block header 
-
-  PUT(heap_listp + (2*WSIZE), PACK(0,0));                       // Space for next pointer 
-  PUT(heap_listp + (3*WSIZE), PACK(0,0));                       // Space for prev pointer 
+  heap->end = heap->heap_listp + INITSIZE + MINBLOCKSIZE;
+  if (heap->id)
+    pagemap_set(heap->heap_listp, INITSIZE + MINBLOCKSIZE, PM_NONE, 0, heap->id);
+  PUT(heap->heap_listp,             PACK(MINBLOCKSIZE, 1));           // Prologue header 
+  PUT(heap->heap_listp +    WSIZE,  PACK(MINBLOCKSIZE, 0));           // Free block header 
+
+  PUT(heap->heap_listp + (2*WSIZE), PACK(0,0));                       // Space for next pointer 
+  PUT(heap->heap_listp + (3*WSIZE), PACK(0,0));                       // Space for prev pointer 
   
-  PUT(heap_listp + (4*WSIZE), PACK(MINBLOCKSIZE, 0));           // Free block footer 
-  PUT(heap_listp + (5*WSIZE), PACK(0, 1));                      // Epilogue header 
+  PUT(heap->heap_listp + (4*WSIZE), PACK(MINBLOCKSIZE, 0));           // Free block footer 
+  PUT(heap->heap_listp + (5*WSIZE), PACK(0, 1));                      // Epilogue header
+  PUT(heap->heap_listp + (7*WSIZE), PACK(0, 1) | PREVALLOC);          // Header the first extension takes over; nothing
+                                                                      // before the first block can be coalesced with
 
   // Point free_list to the first header of the first free block
-  free_listp = heap_listp + (WSIZE);
+  heap->free_listp = heap->heap_listp + (WSIZE);
+  heap->rover = heap->free_listp;
+#if FITINDEX
+  // The index keeps the room it has
+  memset(heap->fit_count, 0, sizeof(heap->fit_count));
+  heap->fit_classes = 0;
+#endif
+#if ADDRORDER && !FITINDEX
+  int i;
+  heap->skip_end = heap->free_listp;
+  for (i = 0; i < SKIPLEVELS; i++)
+    heap->skip_heads[i] = heap->skip_end;
+#endif
+
+  // No slabs, quick listed blocks or counted events yet
+  memset(heap->slab_lists, 0, sizeof(heap->slab_lists));
+  memset(heap->quick_lists, 0, sizeof(heap->quick_lists));
+  heap->quick_count = 0;
+  memset(&heap->counters, 0, sizeof(heap->counters));
 
   return 0;
 }
@@ -145,17 +797,37 @@ int mm_init(void)
  * boundaries.
  *
  * A block is allocated according to this strategy:
- * (1) If a free block of the given size is found, then allocate that free block and return
+ * (1) If the quick list for the block size holds a block, it is popped and returned as is.
+ * (2) If a free block of the given size is found, then allocate that free block and return
  * a pointer to the payload of that block.
- * (2) Otherwise a free block could not be found, so an extension of the heap is necessary.
- * Simply extend the heap and place the allocated block in the new free block.
+ * (3) Otherwise the quick lists are flushed, and the search is repeated over the blocks
+ * that coalescing them produced.
+ * (4) Otherwise a free block could not be found, so an extension of the heap is necessary.
+ * The heap is extended by the shortfall past the wilderness plus a growth chunk, and the
+ * block is placed at the start of the grown wilderness.
  */
 void *mm_malloc(size_t size)
-{  
-  
+{
+  int zeroed;
+
+  return alloc_block(size, &zeroed);
+}
+
+/*
+ * alloc_block - Allocates a block for size bytes like mm_malloc, and sets *zeroed to whether the
+ * block was carved from a ZEROED free block. Its payload is then zero but for up to LINKBYTES at
+ * the start.
+ */
+static void *alloc_block(size_t size, int *zeroed)
+{
+  *zeroed = 0;
   if (size == 0)
       return NULL;
 
+  // Small requests are served from the slabs, except in a heap whose blocks can be moved
+  if (size <= SLABMAX && !heap->noslabs)
+    return slab_alloc(size);
+
   size_t asize;       // Adjusted block size 
   size_t extendsize;  // Amount to extend heap by if no fit 
   char *bp;
@@ -163,178 +835,1180 @@ void *mm_malloc(size_t size)
   /* The size of the new block is equal to the size of the header and footer, plus
    * the size of the payload. Or MINBLOCKSIZE if the requested size is smaller.
    */
-  asize = MAX(ALIGN(size) + DSIZE, MINBLOCKSIZE);
+  asize = ASIZE(size);
+
+  // Take a block of exactly this size from its quick list
+  if (asize <= QUICKMAX) {
+    if ((bp = heap->quick_lists[asize / ALIGNMENT])) {
+      heap->quick_lists[asize / ALIGNMENT] = NEXT_FREE(bp);
+      heap->quick_count--;
+      heap->counters.quick_hits++;
+      return bp;
+    }
+    heap->counters.quick_misses++;
+  }
   
-  // Search the free list for the fit 
-  if ((bp = find_fit(asize))) {
-    place(bp, asize);
+  // Search the free list for the fit, coalescing the quick listed blocks if nothing fits
+  if ((bp = find_fit(asize, 0)) || (heap->quick_count && (quick_flush(), bp = find_fit(asize, 0)))) {
+    *zeroed = IS_ZEROED(bp);
+    return place_by_size(bp, asize);
+  }
+
+  // Otherwise, no fit was found. Grow the wilderness to fit, plus a chunk for later requests.
+  extendsize = asize - wilderness_size() + ALIGN(MIN(mem_region_size(heap->region) / WILDDIV, WILDMAX));
+  if ((bp = extend_heap(extendsize/WSIZE)) == NULL)
+    return NULL;
+
+  // Place the newly allocated block
+  *zeroed = IS_ZEROED(bp);
+  return place_by_size(bp, asize);
+}
+
+/*
+ * mm_calloc - Allocates a zeroed array of nmemb elements of the given size, or returns NULL if
+ * the total size overflows.
+ *
+ * A block carved from a ZEROED free block only has the words the free block's links and footer
+ * took to clear; the rest of the payload has been zero since the heap grew over it.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+  size_t bytes, clear;
+  char *bp;
+  int zeroed;
+
+  if (nmemb && size > (size_t)-1 / nmemb)
+    return NULL;
+  bytes = nmemb * size;
+  if ((bp = alloc_block(bytes, &zeroed)) == NULL)
+    return NULL;
+
+  clear = zeroed ? MIN(bytes, LINKBYTES) : bytes;
+  memset(bp, 0, clear);
+  heap->counters.calloc_bytes += bytes;
+  heap->counters.zero_skipped += bytes - clear;
+  return bp;
+}
+
+/*
+ * mm_memalign - Allocates a block of the given size whose payload is aligned to align bytes. An
+ * align that is not a power of two is rounded up to one.
+ *
+ * Every block is aligned to ALIGNMENT, so smaller alignments are plain mm_malloc requests. Small
+ * requests are rounded up to a multiple of align and served from a slab, whose objects are then
+ * aligned. For the rest place_aligned carves the block out of a free block at the first aligned
+ * spot, and hands the fragment in front of it back for reuse.
+ */
+void *mm_memalign(size_t align, size_t size)
+{
+  size_t p2 = ALIGNMENT;
+  size_t asize, gap;
+  char *bp;
+
+  if (align <= ALIGNMENT)
+    return mm_malloc(size);
+  if (size == 0 || align > MAX_HEAP)
+    return NULL;
+
+  while (p2 < align)
+    p2 <<= 1;
+  heap->counters.aligned_allocs++;
+  if (p2 <= SLABALIGN && ROUNDUP(size, p2) <= SLABMAX && !heap->noslabs)
+    return slab_alloc(ROUNDUP(size, p2));
+
+  // The last block of this size freed may well have been an aligned one
+  asize = ASIZE(size);
+  if (asize <= QUICKMAX && (bp = heap->quick_lists[asize / ALIGNMENT]) &&
+      ((unsigned long)bp & (p2 - 1)) == 0) {
+    heap->quick_lists[asize / ALIGNMENT] = NEXT_FREE(bp);
+    heap->quick_count--;
+    heap->counters.quick_hits++;
+    return bp;
+  }
+  if ((bp = place_aligned(asize, p2, &gap)))
+    heap->counters.align_gap_bytes += gap;
+  return bp;
+}
+
+/*
+ * mm_aligned_alloc - Like mm_memalign, but as C17 aligned_alloc returns NULL if align is not a
+ * power of two.
+ */
+void *mm_aligned_alloc(size_t align, size_t size)
+{
+  if (align == 0 || (align & (align - 1)))
+    return NULL;
+  return mm_memalign(align, size);
+}
+
+/*
+ * mm_malloc_batch - Allocates n blocks of the given size, stores their payload pointers in out,
+ * and returns the number allocated, which is less than n only if the heap ran out.
+ *
+ * Blocks waiting on the quick list of the size are taken first. The rest are carved one after
+ * the other out of a single free block that holds them all, so the search and the free list
+ * update are paid once per batch. Without such a block they are allocated as by mm_malloc.
+ */
+int mm_malloc_batch(size_t size, int n, void **out)
+{
+  size_t asize, total, fsize;
+  char *bp;
+  int i = 0, prev_alloc, zeroed;
+
+  if (size == 0 || n <= 0)
+    return 0;
+
+  // Small requests are served from the slabs, in heaps that make them
+  if (size <= SLABMAX && !heap->noslabs) {
+    for (; i < n && (out[i] = slab_alloc(size)); i++)
+      ;
+    return i;
+  }
+
+  asize = ASIZE(size);
+  if (asize <= QUICKMAX) {
+    for (; i < n && (bp = heap->quick_lists[asize / ALIGNMENT]); i++) {
+      heap->quick_lists[asize / ALIGNMENT] = NEXT_FREE(bp);
+      heap->quick_count--;
+      heap->counters.quick_hits++;
+      out[i] = bp;
+    }
+    if (i == n)
+      return n;
+  }
+
+  /* Find one free block for the rest. Growing the heap by the whole batch leaves
+     the freed runs of earlier batches stranded, so without a fit the rest is
+     allocated one block at a time and may use the fragments and the wilderness. */
+  total = asize * (n - i);
+  if ((bp = find_fit(total, 0)) == NULL &&
+      (heap->quick_count == 0 || (quick_flush(), bp = find_fit(total, 0)) == NULL)) {
+    for (; i < n && (out[i] = alloc_block(size, &zeroed)); i++)
+      ;
+    return i;
+  }
+
+  // Carve the blocks off its front. The last one takes a remainder too small to be a block.
+  fsize = GET_SIZE(HDRP(bp));
+  prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+  remove_freeblock(bp);
+  for (; i < n; i++) {
+    out[i] = bp;
+    fsize -= asize;
+    put_block(bp, (i == n - 1 && fsize < MINBLOCKSIZE) ? asize + fsize : asize, 1, prev_alloc);
+    prev_alloc = 1;
+    bp += asize;
+  }
+  if (fsize >= MINBLOCKSIZE) {
+    put_block(bp, fsize, 0, 1);
+    coalesce(bp);
+  }
+  return n;
+}
+
+/*
+ * mm_free - Frees the block being pointed to by bp.
+ *
+ * Freeing a block is as simple as setting its allocated bit to 0. After
+ * freeing the block, the free blocks should be coalesced to ensure high
+ * memory utilization. Blocks of quick list sizes are instead pushed on their
+ * quick list, still marked allocated, and coalesced when the lists are flushed.
+ */
+void mm_free(void *bp)
+{ 
+  mm_heap_t *h;
+  
+  // Ignore spurious requests 
+  if (!bp)
+      return;
+
+  // Blocks of another heap are freed in that heap
+  if ((h = heap_of(bp)) != heap) {
+    mm_heap_free(h, bp);
+    return;
+  }
+
+  // Slab objects go back to their slab
+  if (pagemap_get(bp)->kind == PM_SLAB) {
+    slab_free(bp);
+    return;
+  }
+
+  free_block(bp);
+}
+
+/*
+ * mm_free_sized - Frees bp like mm_free, given the size last asked for it: the size passed to
+ * mm_malloc, mm_memalign, mm_malloc_batch or mm_realloc, or the total passed to mm_calloc.
+ * mm_try_expand changes it too: after a call that returned 1 with a larger size, that size is
+ * the one to pass.
+ *
+ * Slab objects never hold more than SLABMAX bytes, so a larger size rules them out and the
+ * block is freed without looking bp up in the page map.
+ */
+void mm_free_sized(void *bp, size_t size)
+{
+  if (!bp)
+    return;
+
+#if SIZECHECK
+  check_size(bp, size);
+#endif
+  if (size <= SLABMAX || heap_of(bp) != heap)
+    mm_free(bp);
+  else
+    free_block(bp);
+}
+
+/*
+ * free_block - Frees the boundary tagged block bp, through the quick lists if it is small.
+ */
+static void free_block(void *bp)
+{
+  size_t size = GET_SIZE(HDRP(bp));
+
+  // Defer coalescing small blocks
+  if (size <= QUICKMAX) {
+    quick_push(bp, size);
+    return;
+  }
+
+  /* Set the header and footer allocated bits to 0, thus
+   * freeing the block */
+  put_block(bp, size, 0, GET_PREV_ALLOC(HDRP(bp)));
+
+  // Coalesce to merge any free blocks and add them to the list 
+  coalesce(bp);
+}
+
+/*
+ * mm_free_batch - Frees the n blocks in ptrs, which it sorts by address in place.
+ *
+ * After sorting, each run of blocks that lie next to each other in the heap is freed as a single
+ * block with a single coalesce, so a batch that was allocated together goes back in one piece
+ * rather than through the quick lists one block at a time. NULL pointers are ignored.
+ */
+void mm_free_batch(void **ptrs, int n)
+{
+  char *bp;
+  size_t size;
+  int i, j;
+
+  qsort(ptrs, n, sizeof(void *), ptr_cmp);
+  for (i = 0; i < n; i = j) {
+    bp = ptrs[i];
+    j = i + 1;
+    if (bp == NULL)
+      continue;
+    if (pagemap_get(bp)->kind == PM_SLAB || heap_of(bp) != heap) {
+      mm_free(bp);
+      continue;
+    }
+
+    size = GET_SIZE(HDRP(bp));
+    for (; j < n && ptrs[j] == bp + size; j++)
+      size += GET_SIZE(HDRP(ptrs[j]));
+    put_block(bp, size, 0, GET_PREV_ALLOC(HDRP(bp)));
+    coalesce(bp);
+  }
+}
+
+/*
+ * ptr_cmp - Orders pointers by address, for qsort.
+ */
+static int ptr_cmp(const void *a, const void *b)
+{
+  char *p = *(char * const *)a;
+  char *q = *(char * const *)b;
+
+  return (p > q) - (p < q);
+}
+
+/*
+ * mm_realloc - Resizes the block pointed to by ptr to hold size bytes.
+ *
+ * A block is resized according to this strategy:
+ * (1) If the block is already large enough, it is kept, and any excess large enough to form
+ * a block of its own is split off and freed.
+ * (2) If the block can grow in place, either into a free next block or, when it sits at the
+ * end of the heap, by extending the heap by only the shortfall, it is grown and kept.
+ * (3) If a free previous block (together with a free next block) makes enough room, the
+ * blocks are merged and the payload is slid down into the previous block.
+ * (4) Otherwise a new block is allocated, the payload is copied over, and the old block is freed.
+ *
+ * Blocks that realloc has grown are tagged GROWN. A tagged block that needs to grow again is
+ * likely to keep growing (think of a vector being appended to), so it is moved into a block
+ * with SLACK bytes of room behind it, and any free room left behind a grown block is reserved
+ * for it (see reserve_slack). One-shot blocks are never given slack.
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+  // If ptr is NULL, realloc is equivalent to mm_malloc(size)
+  if (ptr == NULL)
+    return mm_malloc(size);
+
+  // If size is equal to zero, realloc is equivalent to mm_free(ptr)
+  if (size == 0) {
+    mm_free(ptr);
+    return NULL;
+  }
+
+  // A block of another heap is resized in that heap
+  mm_heap_t *h;
+  void *bp;
+  if ((h = heap_of(ptr)) != heap)
+    return mm_heap_realloc(h, ptr, size);
+    
+  // A slab object stays put while it fits in its size class, and moves otherwise
+  int objsize;
+  if ((objsize = slab_objsize(ptr))) {
+    if (size <= objsize)
+      return ptr;
+    if ((bp = mm_malloc(size)) == NULL)
+      return NULL;
+    memcpy(bp, ptr, objsize);
+    mm_free(ptr);
     return bp;
   }
 
-  // Otherwise, no fit was found. Grow the heap larger. 
-  extendsize = MAX(asize, MINBLOCKSIZE);
-  if ((bp = extend_heap(extendsize/WSIZE)) == NULL)
-    return NULL;
+  /* Otherwise, we assume ptr is not NULL and was returned by an earlier malloc or realloc call.
+   * Get the size of the current block */
+  size_t asize = ASIZE(size);
+  size_t current_size = GET_SIZE(HDRP(ptr));
+  size_t grown = GET_TAG(HDRP(ptr));
+
+  // Case 1: The current block is already large enough 
+  if (asize <= current_size) {
+    shrink_block(ptr, asize);
+    return ptr;
+  }
+
+  // Case 2: The block can be grown in place 
+  if (grow_block(ptr, asize))
+    bp = ptr;
+
+  // Case 3: The payload can be moved down into a free previous block
+  else if ((bp = slide_block(ptr, asize)))
+    ;
+
+  // Case 4: Allocate a new block of the requested size and release the current block
+  else {
+    if (grown && (bp = mm_malloc(size + SLACK(asize)))) {
+      if (!slab_objsize(bp))
+        shrink_block(bp, asize);
+    }
+    else if ((bp = mm_malloc(size)) == NULL)
+      return NULL;
+    memcpy(bp, ptr, current_size - OVERHEAD);
+    mm_free(ptr);
+
+    // A new block of SLABMAX bytes or less is a slab object, with no header to tag or room to reserve
+    if (slab_objsize(bp))
+      return bp;
+  }
+
+  SET_TAG(HDRP(bp));
+  if (grown)
+    reserve_slack(bp);
+  return bp;
+}
+
+/*
+ * mm_usable_size - Returns the number of payload bytes the allocated block ptr can hold, which
+ * includes any remainder too small to split off when the block was placed, or 0 if ptr is NULL.
+ */
+size_t mm_usable_size(void *ptr)
+{
+  int objsize;
+
+  if (ptr == NULL)
+    return 0;
+  if ((objsize = slab_objsize(ptr)))
+    return objsize;
+  return GET_SIZE(HDRP(ptr)) - OVERHEAD;
+}
+
+/*
+ * mm_try_expand - Grows the allocated block ptr to hold size bytes without moving it, as
+ * mm_realloc's case (2) would. Returns 1 if the block now holds size bytes and 0, leaving it
+ * untouched, if it could not grow in place. Blocks are never shrunk.
+ *
+ * A block grown here is tagged GROWN like one grown by mm_realloc, so the room behind it is
+ * reserved when it grows again.
+ */
+int mm_try_expand(void *ptr, size_t size)
+{
+  mm_heap_t *h, *saved;
+  int objsize, rc;
+  size_t asize, grown;
+
+  if (ptr == NULL)
+    return 0;
+  if ((objsize = slab_objsize(ptr)))
+    return size <= objsize;
+
+  // A block of another heap grows in that heap
+  if ((h = heap_of(ptr)) != heap) {
+    saved = heap;
+    heap = h;
+    if (h->shared)
+      shared_enter(h);
+    rc = mm_try_expand(ptr, size);
+    if (h->shared)
+      shared_leave(h);
+    heap = saved;
+    return rc;
+  }
+
+  asize = ASIZE(size);
+  if (asize <= GET_SIZE(HDRP(ptr)))
+    return 1;
+
+  grown = GET_TAG(HDRP(ptr));
+  if (!grow_block(ptr, asize))
+    return 0;
+  SET_TAG(HDRP(ptr));
+  if (grown)
+    reserve_slack(ptr);
+  return 1;
+}
+
+/*
+ * mm_pool_create - Creates a pool of objects of objsize bytes aligned to align (a power of two;
+ * 0 means ALIGNMENT), or returns NULL if align is not a power of two or out of memory.
+ *
+ * The pool takes chunks of at least POOLCHUNK bytes from the heap, each recorded in the page
+ * map as PM_POOL pages, and serves objects from them with no header or footer, LIFO from a free
+ * list per chunk. A chunk whose objects are all free goes back to the heap, unless it is the only
+ * chunk of the pool with free objects. Pools live in the heap, and go away with mm_heap_reset.
+ */
+mm_pool_t *mm_pool_create(size_t objsize, size_t align)
+{
+  mm_pool_t *pool;
+
+  if (align < ALIGNMENT)
+    align = ALIGNMENT;
+  if ((align & (align - 1)) || objsize > MAX_HEAP / POOLMINOBJS)
+    return NULL;
+  if ((pool = mm_malloc(sizeof(mm_pool_t))) == NULL)
+    return NULL;
+
+  pool->objsize = ROUNDUP(MAX(objsize, sizeof(void *)), align);
+  pool->first = ROUNDUP(sizeof(pool_chunk_t), align);
+  pool->chunksize = ROUNDUP(MAX(POOLCHUNK, pool->first + POOLMINOBJS * pool->objsize + OVERHEAD),
+                            PM_PAGESIZE);
+  pool->chunkalign = MAX(align, PM_PAGESIZE);
+  pool->nobjs = (pool->chunksize - OVERHEAD - pool->first) / pool->objsize;
+  pool->chunks = pool->full = NULL;
+  return pool;
+}
+
+/*
+ * mm_pool_alloc - Allocates an object from pool, taking a new chunk from the heap if no chunk
+ * has a free object. Returns NULL if out of memory.
+ */
+void *mm_pool_alloc(mm_pool_t *pool)
+{
+  pool_chunk_t *chunk = pool->chunks;
+  void *obj;
+
+  if (chunk == NULL && (chunk = pool_grow(pool)) == NULL)
+    return NULL;
+
+  // Reuse the last object freed, or else hand out the next fresh one
+  if ((obj = chunk->free))
+    chunk->free = *(void **)obj;
+  else {
+    obj = (char *)chunk + pool->first + (pool->nobjs - chunk->nfresh) * pool->objsize;
+    chunk->nfresh--;
+  }
+
+  // A full chunk moves to the full list
+  if (--chunk->nfree == 0) {
+    pool_unlink(&pool->chunks, chunk);
+    pool_link(&pool->full, chunk);
+  }
+  return obj;
+}
+
+/*
+ * mm_pool_free - Returns obj, allocated from pool, to its chunk, which the page map finds.
+ */
+void mm_pool_free(mm_pool_t *pool, void *obj)
+{
+  pool_chunk_t *chunk;
+
+  if (obj == NULL)
+    return;
+
+  chunk = pagemap_span(obj);
+  *(void **)obj = chunk->free;
+  chunk->free = obj;
+
+  if (chunk->nfree++ == 0) {
+    pool_unlink(&pool->full, chunk);
+    pool_link(&pool->chunks, chunk);
+  }
+  else if (chunk->nfree == pool->nobjs && (chunk->prev || chunk->next)) {
+    pool_unlink(&pool->chunks, chunk);
+    pool_release(pool, chunk);
+  }
+}
+
+/*
+ * mm_pool_destroy - Returns every chunk of pool to the heap, whether or not its objects are
+ * free, and frees the pool itself.
+ */
+void mm_pool_destroy(mm_pool_t *pool)
+{
+  pool_chunk_t *chunk;
+
+  while ((chunk = pool->chunks)) {
+    pool_unlink(&pool->chunks, chunk);
+    pool_release(pool, chunk);
+  }
+  while ((chunk = pool->full)) {
+    pool_unlink(&pool->full, chunk);
+    pool_release(pool, chunk);
+  }
+  mm_free(pool);
+}
+
+/*
+ * mm_halloc - Allocates a relocatable block of size bytes and returns its handle, or 0 if out
+ * of memory. The block is reached through mm_hpin, and mm_compact may move it while it is not
+ * pinned.
+ *
+ * Handle blocks live in a heap of their own that makes no slabs, so that every allocated block
+ * in it carries a handle. The handle is kept in the first DSIZE bytes of the block's payload.
+ */
+mm_handle_t mm_halloc(size_t size)
+{
+  mm_heap_t *saved = heap;
+  handle_t *table;
+  unsigned int h;
+  char *bp;
+
+  if (size == 0)
+    return 0;
+  if (handles.heap == NULL) {
+    if ((handles.heap = mm_heap_create()) == NULL)
+      return 0;
+    handles.heap->noslabs = 1;
+  }
+
+  // Take an unused entry, growing the table if there is none
+  if ((h = handles.free) == 0) {
+    if (handles.count >= handles.size) {
+      if ((table = mm_realloc(handles.table, 2 * MAX(handles.size, HANDLEMIN / 2) * sizeof(handle_t))) == NULL)
+        return 0;
+      handles.table = table;
+      handles.size = 2 * MAX(handles.size, HANDLEMIN / 2);
+    }
+    h = handles.count++;
+  }
+  else
+    handles.free = handles.table[h].pins;
+
+  heap = handles.heap;
+  if ((bp = mm_malloc(size + DSIZE)))
+    handles.live += GET_SIZE(HDRP(bp));
+  heap = saved;
+  if (bp == NULL) {
+    handles.table[h].bp = NULL;
+    handles.table[h].pins = handles.free;
+    handles.free = h;
+    return 0;
+  }
+  PUT(bp, h);
+  handles.table[h].bp = bp;
+  handles.table[h].pins = 0;
+  return h;
+}
+
+/*
+ * mm_hpin - Pins the block of handle h where it is and returns its address, which stays valid
+ * until as many mm_hunpin calls as mm_hpin calls have been made.
+ */
+void *mm_hpin(mm_handle_t h)
+{
+  handles.table[h].pins++;
+  return handles.table[h].bp + DSIZE;
+}
+
+/*
+ * mm_hunpin - Undoes an mm_hpin of handle h. Once no pins are left, mm_compact may move its block.
+ */
+void mm_hunpin(mm_handle_t h)
+{
+  handles.table[h].pins--;
+}
+
+/*
+ * mm_hfree - Frees the block of handle h, pinned or not, and the handle itself.
+ */
+void mm_hfree(mm_handle_t h)
+{
+  if (h == 0)
+    return;
+  if (handles.cursor == h)
+    handles.cursor = 0;
+  handles.live -= GET_SIZE(HDRP(handles.table[h].bp));
+  mm_heap_free(handles.heap, handles.table[h].bp);
+  handles.table[h].bp = NULL;
+  handles.table[h].pins = handles.free;
+  handles.free = h;
+}
+
+/*
+ * mm_compact - Takes one step of compacting the blocks of the handles, and returns 1 if the
+ * pass it belongs to has more to do or 0 if the pass is done (the next step starts a new one).
+ *
+ * A pass walks the handle heap from its start. Each unpinned block with a free block before it
+ * is slid down over that free block with slide_block, and the free space moves up behind it, to
+ * merge with the next free block and in the end with the wilderness. The step stops before it
+ * would copy more than budget bytes or visit more than budget / MINBLOCKSIZE allocated blocks,
+ * which bounds its pause, and the next step goes on from there. It visits one block at least, so
+ * that every step gets on, however small its budget. A block larger than budget is never moved.
+ *
+ * Sliding a block down over a hole leaves every block after it to slide as well, so a pass only
+ * starts once the free blocks below the wilderness make up more than 1/COMPACTDIV of the heap.
+ */
+int mm_compact(size_t budget)
+{
+  mm_heap_t *saved = heap;
+  size_t size, copied = 0, visits = 0;
+  unsigned int h, moves = 0;
+  char *bp, *newbp;
+  int more = 1;
+
+  if (handles.heap == NULL)
+    return 0;
+  heap = handles.heap;
+
+  // Start a pass only if there are holes enough to be worth it
+  if (handles.cursor == 0 && mem_region_size(heap->region) - handles.live - wilderness_size() <=
+      mem_region_size(heap->region) / COMPACTDIV) {
+    heap = saved;
+    return 0;
+  }
+
+  // Blocks on the quick lists look allocated, but carry no handle
+  if (heap->quick_count)
+    quick_flush();
+
+  // The first block of the heap follows the prologue and the list sentinel
+  bp = handles.cursor ? NEXT_BLKP(handles.table[handles.cursor].bp) :
+                        heap->heap_listp + INITSIZE + MINBLOCKSIZE;
+  for (; ; bp = NEXT_BLKP(bp)) {
+    if ((size = GET_SIZE(HDRP(bp))) == 0) {
+      handles.cursor = 0;
+      more = 0;
+      break;
+    }
+    if (!GET_ALLOC(HDRP(bp)))
+      continue;
+    if (++visits > MAX(budget / MINBLOCKSIZE, 1))
+      break;
+
+    h = GET(bp);
+    if (!GET_PREV_ALLOC(HDRP(bp)) && handles.table[h].pins == 0 && size <= budget) {
+      if (copied + size > budget)
+        break;
+      newbp = slide_block(bp, size);
+      handles.table[h].bp = newbp;
+      bp = newbp;
+      copied += size;
+      moves++;
+    }
+    handles.cursor = h;
+  }
+
+  heap->counters.compact_steps++;
+  heap->counters.compact_moves += moves;
+  heap->counters.compact_bytes += copied;
+  heap->counters.compact_max_step = MAX(heap->counters.compact_max_step, copied);
+  heap = saved;
+  return more;
+}
+
+/*
+ * shrink_block - Shrinks the allocated block bp to asize bytes. The excess is split off
+ * and freed if it is large enough to form a block of its own, otherwise it stays in bp.
+ */
+static void shrink_block(void *bp, size_t asize)
+{
+  size_t size = GET_SIZE(HDRP(bp));
+
+  if ((size - asize) >= MINBLOCKSIZE) {
+    put_block(bp, asize, 1, GET_PREV_ALLOC(HDRP(bp)));
+    bp = NEXT_BLKP(bp);
+    put_block(bp, size - asize, 0, 1);
+    coalesce(bp);
+  }
+}
+
+/*
+ * grow_block - Attempts to grow the allocated block bp to asize bytes without moving it.
+ * Returns 1 on success and 0 if the block could not be grown in place.
+ *
+ * The block absorbs the next block if that is free. When that is not enough but the block
+ * (or its free neighbor) is the last one before the epilogue, the heap is extended by just
+ * the shortfall instead of moving the whole payload to a new block.
+ */
+static int grow_block(void *bp, size_t asize)
+{
+  size_t size = GET_SIZE(HDRP(bp));
+  void *next = NEXT_BLKP(bp);
+  size_t next_size = GET_ALLOC(HDRP(next)) ? 0 : GET_SIZE(HDRP(next));
+
+  if (size + next_size < asize) {
+
+    // Only the block at the end of the heap can grow past its free neighbor
+    if (GET_SIZE(HDRP(next_size ? NEXT_BLKP(next) : next)) != 0)
+      return 0;
+
+    // The extension lands right after bp and coalesces with the free neighbor (if any)
+    if (extend_heap((asize - size - next_size)/WSIZE) == NULL)
+      return 0;
+    next_size = GET_SIZE(HDRP(next));
+  }
+
+  // Absorb the free next block and give back whatever is not needed
+  remove_freeblock(next);
+  put_block(bp, size + next_size, 1, GET_PREV_ALLOC(HDRP(bp)));
+  shrink_block(bp, asize);
+  return 1;
+}
+
+/*
+ * reserve_slack - Marks the free block right after the growing block bp as RESERVED, so that
+ * find_fit passes it over until nothing else fits and bp can later grow into it in place.
+ * Free blocks larger than bp itself are too much to hold back and are left alone.
+ */
+static void reserve_slack(void *bp)
+{
+  void *next = NEXT_BLKP(bp);
+
+  if (!GET_ALLOC(HDRP(next)) && GET_SIZE(HDRP(next)) <= GET_SIZE(HDRP(bp)))
+    SET_TAG(HDRP(next));
+}
+
+/*
+ * slide_block - Attempts to grow the allocated block bp to asize bytes by merging it with
+ * a free previous block, and with the next block too if that is free. The payload is slid
+ * down to the start of the merged block with memmove, since the two may overlap. Returns
+ * the new payload pointer, or NULL if the free neighbors don't make enough room.
+ */
+static void *slide_block(void *bp, size_t asize)
+{
+  void *prev;
+  void *next = NEXT_BLKP(bp);
+  size_t size = GET_SIZE(HDRP(bp));
+  size_t prev_size, next_size;
+
+  if (GET_PREV_ALLOC(HDRP(bp)))
+    return NULL;
+  prev = PREV_BLKP(bp);
+  prev_size = GET_SIZE(HDRP(prev));
+  next_size = GET_ALLOC(HDRP(next)) ? 0 : GET_SIZE(HDRP(next));
+  if (prev_size + size + next_size < asize)
+    return NULL;
+
+  // Unlink the neighbors before the move overwrites their list pointers
+  remove_freeblock(prev);
+  if (next_size)
+    remove_freeblock(next);
+  memmove(prev, bp, size - OVERHEAD);
+
+  put_block(prev, prev_size + size + next_size, 1, 1);
+  shrink_block(prev, asize);
+  return prev;
+}
+
+
+/*
+ * extend_heap - Extends the heap by the given number of words rounded up to the 
+ * nearest even integer.
+ */
+static void *extend_heap(size_t words)
+{
+  char *bp;
+  size_t asize, heapsize;
+  int prev_alloc, zeroed;
+
+  /* Adjust the size so the alignment and minimum block size requirements
+   * are met. */ 
+  asize = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
+  if (asize < MINBLOCKSIZE)
+    asize = MINBLOCKSIZE;
+
+  /* Round the extension so the new end of the heap falls on a multiple of the
+   * memory system's growth granularity (a huge page when the heap is THP backed) */
+  heapsize = mem_region_size(heap->region);
+  asize = ROUNDUP(heapsize + asize, mem_growsize()) - heapsize;
+
+  // Attempt to grow the heap by the adjusted size, over storage that is still zero if it was never
+  // part of the heap before
+  zeroed = (char *)mem_region_clean_lo(heap->region) == (char *)mem_region_hi(heap->region) + 1;
+  if ((bp = mem_region_sbrk(heap->region, asize)) == (void *)-1)
+    return NULL;
+  heap->end = bp + asize;
+  if (heap->id)
+    pagemap_set(bp, asize, PM_NONE, 0, heap->id);
+
+  /* Set the header and footer of the newly created free block over the old
+   * epilogue, and push the epilogue header to the back */
+  prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+  PUT(HDRP(bp + asize), PACK(0, 1)); /* Move the epilogue to the end */
+  put_block(bp, asize, 0, prev_alloc);
+  if (zeroed)
+    SET_ZEROED(bp);
+
+  // Coalesce any partitioned free memory 
+  return coalesce(bp); 
+}
+
+/*
+ * find_fit - Attempts to find a free block of at least the given size in the free list.
+ *
+ * This function implements a first-fit search strategy for an explicit free list, which 
+ * is simply a doubly linked list of free blocks. The wilderness, and then blocks RESERVED
+ * as slack for a growing block, are only handed out when no other block fits, i.e. when
+ * the heap would otherwise have to grow.
+ *
+ * With NEXTFIT the search runs from the rover to the end of the list and then from the front
+ * of the list up to the rover, and the rover is left on the block found.
+ *
+ * A nonzero align asks for a block that holds size bytes past its align_gap, for place_aligned.
+ * The index can only be searched by size, so with FITINDEX room for the worst-case gap is asked.
+ */
+static void *find_fit(size_t size, size_t align)
+{
+  void *bp;
+  void *wilderness = NULL;
+  void *reserved = NULL;
+
+  heap->counters.fit_searches++;
 
-  // Place the newly allocated block
-  place(bp, asize);
+#if FITINDEX
+  return index_fit(align ? size + align + MINBLOCKSIZE : size);
+#endif
 
-  return bp;
+  // First-fit search, or next-fit search in two legs
+  if (NEXTFIT) {
+    if ((bp = scan_fit(heap->rover, NULL, size, align, &wilderness, &reserved)) ||
+        (bp = scan_fit(heap->free_listp, heap->rover, size, align, &wilderness, &reserved)))
+      return heap->rover = bp;
+  }
+  else if ((bp = scan_fit(heap->free_listp, NULL, size, align, &wilderness, &reserved)))
+    return bp;
+
+  // Otherwise carve up the wilderness or reclaim reserved slack, if any, rather than grow the heap
+  return wilderness ? wilderness : reserved; 
 }
 
 /*
- * mm_free - Frees the block being pointed to by bp.
- *
- * Freeing a block is as simple as setting its allocated bit to 0. After
- * freeing the block, the free blocks should be coalesced to ensure high
- * memory utilization. 
+ * scan_fit - Walks the free list from bp up to stop (or the end of the list) and returns the
+ * first block of at least the given size (past its align_gap, if align is nonzero), passing over
+ * the wilderness and RESERVED blocks. The first of those that fit are left in *wilderness and
+ * *reserved.
  */
-void mm_free(void *bp)
-{ 
-  
-  // Ignore spurious requests 
-  if (!bp)
-      return;
+static void *scan_fit(void *bp, void *stop, size_t size, size_t align, void **wilderness, void **reserved)
+{
+  for (; bp != stop && GET_ALLOC(HDRP(bp)) == 0; bp = NEXT_FREE(bp)) {
+    heap->counters.fit_probes++;
+    if (size + (align ? align_gap(bp, align) : 0) <= GET_SIZE(HDRP(bp))) {
+      if (GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0)
+        *wilderness = bp;
+      else if (!GET_TAG(HDRP(bp)))
+        return bp; 
+      else if (!*reserved)
+        *reserved = bp;
+    }
+  }
+  return NULL;
+}
 
-  size_t size = GET_SIZE(HDRP(bp));
+#if FITINDEX
 
-  /* Set the header and footer allocated bits to 0, thus
-   * freeing the block */
-  PUT(HDRP(bp), PACK(size, 0));
-  PUT(FTRP(bp), PACK(size, 0));
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-  // Coalesce to merge any free blocks and add them to the list 
-  coalesce(bp);
+#define FIT_CLASS(size) (31 - __builtin_clz((unsigned int)((size) / MINBLOCKSIZE)))
+#define FIT_OFFSET(bp)  ((unsigned int)((char *)(bp) - heap->heap_listp))
+#define FIT_POS(bp)     (*(unsigned int *)(bp))   // Entry of a free block in its class, in its NEXT word
+
+/*
+ * index_scan - Returns the first i in [from, n) with v[i] >= key, or n if there is none.
+ * Compares 8 or 4 entries at a time when AVX2 or SSE2 is available; the compares are signed,
+ * which is fine for block sizes below 2 GB.
+ */
+static unsigned int index_scan(unsigned int *v, unsigned int from, unsigned int n, unsigned int key)
+{
+  unsigned int i = from;
+  int mask;
+
+#if defined(__AVX2__)
+  __m256i key8 = _mm256_set1_epi32(key - 1);
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_cmpgt_epi32(_mm256_loadu_si256((__m256i *)&v[i]), key8);
+    if ((mask = _mm256_movemask_ps(_mm256_castsi256_ps(x))))
+      return i + __builtin_ctz(mask);
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i key4 = _mm_set1_epi32(key - 1);
+  for (; i + 4 <= n; i += 4) {
+    __m128i x = _mm_cmpgt_epi32(_mm_loadu_si128((__m128i *)&v[i]), key4);
+    if ((mask = _mm_movemask_ps(_mm_castsi128_ps(x))))
+      return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < n; i++)
+    if (v[i] >= key)
+      return i;
+  return n;
 }
 
 /*
- * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
+ * index_fit - find_fit on the index. The classes with entries are searched from the one size
+ * falls in upwards, and the wilderness and RESERVED blocks are passed over as in scan_fit.
  */
-void *mm_realloc(void *ptr, size_t size)
+static void *index_fit(size_t size)
 {
-  // If ptr is NULL, realloc is equivalent to mm_malloc(size)
-  if (ptr == NULL)
-    return mm_malloc(size);
+  void *wilderness = NULL;
+  void *reserved = NULL;
+  unsigned int *sizes, i, n;
+  unsigned int classes;
+  int c = FIT_CLASS(size);
+  char *bp;
 
-  // If size is equal to zero, realloc is equivalent to mm_free(ptr)
-  if (size == 0) {
-    mm_free(ptr);
+  if (c >= FITCLASSES)
     return NULL;
+  for (classes = heap->fit_classes >> c; classes; classes >>= 1, c++) {
+    c += __builtin_ctz(classes);
+    classes >>= __builtin_ctz(classes);
+    sizes = heap->fit_sizes[c];
+    n = heap->fit_count[c];
+    for (i = 0; (i = index_scan(sizes, i, n, size)) < n; i++) {
+      heap->counters.fit_probes++;
+      bp = heap->heap_listp + heap->fit_offs[c][i];
+      if (GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0)
+        wilderness = bp;
+      else if (!GET_TAG(HDRP(bp)))
+        return bp;
+      else if (!reserved)
+        reserved = bp;
+    }
   }
-    
-  /* Otherwise, we assume ptr is not NULL and was returned by an earlier malloc or realloc call.
-   * Get the size of the current payload */
-  size_t asize = MAX(ALIGN(size) + DSIZE, MINBLOCKSIZE);
-  size_t current_size = GET_SIZE(HDRP(ptr));
+  return wilderness ? wilderness : reserved;
+}
 
-  void *bp;
-  char *next = HDRP(NEXT_BLKP(ptr));
-  size_t newsize = current_size + GET_SIZE(next);
+#endif /* FITINDEX */
 
-  /* Case 1: Size is equal to the current payload size */
-  if (asize == current_size)
-    return ptr;
+/*
+ * wilderness_size - Returns the size of the free block at the end of the heap, or 0 if the last
+ * block is allocated (as far as the epilogue header can tell).
+ */
+static size_t wilderness_size(void)
+{
+  char *epilogue = (char *)mem_region_hi(heap->region) + 1 - WSIZE;
 
-  // Case 2: Size is less than the current payload size 
-  if ( asize <= current_size ) {
+  return GET_PREV_ALLOC(epilogue) ? 0 : GET_SIZE(epilogue - WSIZE);
+}
 
-    if( asize > MINBLOCKSIZE && (current_size - asize) > MINBLOCKSIZE) {  
+#if FITINDEX
 
-      PUT(HDRP(ptr), PACK(asize, 1));
-      PUT(FTRP(ptr), PACK(asize, 1));
-      bp = NEXT_BLKP(ptr);
-      PUT(HDRP(bp), PACK(current_size - asize, 1));
-      PUT(FTRP(bp), PACK(current_size - asize, 1));
-      mm_free(bp);
-      return ptr;
-    }
+/*
+ * insert_freeblock - Adds an entry for the free block bp at the end of its class in the index.
+ */
+static void insert_freeblock(void *bp)
+{
+  size_t size = GET_SIZE(HDRP(bp));
+  int c = FIT_CLASS(size);
+  unsigned int pos;
+
+  if (heap->fit_count[c] == heap->fit_room[c])
+    index_grow(c);
+  pos = heap->fit_count[c]++;
+  heap->fit_sizes[c][pos] = size;
+  heap->fit_offs[c][pos] = FIT_OFFSET(bp);
+  FIT_POS(bp) = pos;
+  heap->fit_classes |= 1u << c;
+}
 
-    // allocate a new block of the requested size and release the current block
-    bp = mm_malloc(asize);
-    memcpy(bp, ptr, asize);
-    mm_free(ptr);
-    return bp;
-  }
+/*
+ * remove_freeblock - Removes the entry of the free block bp from the index by moving the last
+ * entry of its class into its place. bp must still have the size it was indexed with.
+ */
+static void remove_freeblock(void *bp)
+{
+  int c = FIT_CLASS(GET_SIZE(HDRP(bp)));
+  unsigned int last = --heap->fit_count[c];
+  unsigned int pos = FIT_POS(bp);
+
+  heap->fit_sizes[c][pos] = heap->fit_sizes[c][last];
+  heap->fit_offs[c][pos] = heap->fit_offs[c][last];
+  FIT_POS(heap->heap_listp + heap->fit_offs[c][pos]) = pos;
+  if (heap->fit_count[c] == 0)
+    heap->fit_classes &= ~(1u << c);
+}
 
-  // Case 3: Requested size is greater than the current payload size 
-  else {
+/*
+ * index_size - Returns the bytes an index laid out in full by index_layout takes, for a heap of
+ * up to size bytes.
+ */
+static size_t index_size(size_t size)
+{
+  size_t entries = 0;
+  int c;
 
-    // next block is unallocated and is large enough to complete the request
-    // merge current block with next block up to the size needed and free the 
-    // remaining block.
-    if ( !GET_ALLOC(next) && newsize >= asize ) {
-
-      // merge, split, and release
-      remove_freeblock(NEXT_BLKP(ptr));
-      PUT(HDRP(ptr), PACK(asize, 1));
-      PUT(FTRP(ptr), PACK(asize, 1));
-      bp = NEXT_BLKP(ptr);
-      PUT(HDRP(bp), PACK(newsize-asize, 1));
-      PUT(FTRP(bp), PACK(newsize-asize, 1));
-      mm_free(bp);
-      return ptr;
-    }  
-    
-    // otherwise allocate a new block of the requested size and release the current block
-    bp = mm_malloc(asize); 
-    memcpy(bp, ptr, current_size);
-    mm_free(ptr);
-    return bp;
+  for (c = 0; c < FITCLASSES; c++)
+    entries += size / (MINBLOCKSIZE << c) + 1;
+  return 2 * entries * sizeof(unsigned int);
+}
+
+/*
+ * index_layout - Lays the index of heap out in full at p, for a heap of up to size bytes: each
+ * class gets room for as many blocks of its smallest size as the heap could hold, so the index
+ * never grows. Shared heaps keep their index this way, in their own region.
+ */
+static void index_layout(char *p, size_t size)
+{
+  int c;
+
+  for (c = 0; c < FITCLASSES; c++) {
+    heap->fit_room[c] = size / (MINBLOCKSIZE << c) + 1;
+    heap->fit_sizes[c] = (unsigned int *)p;
+    heap->fit_offs[c] = heap->fit_sizes[c] + heap->fit_room[c];
+    p = (char *)(heap->fit_offs[c] + heap->fit_room[c]);
   }
+}
 
+/*
+ * index_grow - Doubles the room of class c in the index of heap, a private heap, whose index
+ * grows with the number of free blocks in storage from the C library.
+ */
+static void index_grow(int c)
+{
+  unsigned int room = heap->fit_room[c] ? 2 * heap->fit_room[c] : FITMIN;
+  unsigned int *sizes, *offs;
+
+  if ((sizes = realloc(heap->fit_sizes[c], room * sizeof(unsigned int))))
+    heap->fit_sizes[c] = sizes;
+  if ((offs = realloc(heap->fit_offs[c], room * sizeof(unsigned int))))
+    heap->fit_offs[c] = offs;
+  if (sizes == NULL || offs == NULL) {
+    fprintf(stderr, "index_grow: out of memory for the free block index\n");
+    abort();
+  }
+  heap->fit_room[c] = room;
 }
 
+#elif ADDRORDER
 
 /*
- * extend_heap - Extends the heap by the given number of words rounded up to the 
- * nearest even integer.
+ * skip_height - Returns the number of skip list levels the free block bp is linked into. Levels
+ * are drawn from a hash of its heap offset, which every process mapping a shared heap agrees on,
+ * each one half as likely as the one below, and capped by the room in the payload past the NEXT
+ * and PREV pointers. A free block must not change size
+ * while it is on the list, since its height has to be the same when it is removed.
  */
-static void *extend_heap(size_t words)
+static int skip_height(void *bp)
 {
-  char *bp;
-  size_t asize;
-
-  /* Adjust the size so the alignment and minimum block size requirements
-   * are met. */ 
-  asize = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
-  if (asize < MINBLOCKSIZE)
-    asize = MINBLOCKSIZE;
-  
-  // Attempt to grow the heap by the adjusted size 
-  if ((bp = mem_sbrk(asize)) == (void *)-1)
-    return NULL;
+  unsigned int hash = (unsigned int)(((char *)bp - heap->heap_listp) / ALIGNMENT) * 0x9e3779b1u;
+  int height = 1 + __builtin_ctz(hash | (1u << (SKIPLEVELS - 1)));
+  int room = (GET_SIZE(HDRP(bp)) - DSIZE) / WSIZE - 1;
 
-  /* Set the header and footer of the newly created free block, and
-   * push the epilogue header to the back */
-  PUT(HDRP(bp), PACK(asize, 0));
-  PUT(FTRP(bp), PACK(asize, 0));
-  PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* Move the epilogue to the end */
+  return MIN(height, room);
+}
 
-  // Coalesce any partitioned free memory 
-  return coalesce(bp); 
+/*
+ * skip_find - Sets preds[i] to the last block at level i whose address is below bp, or to NULL
+ * when no block at that level is. The search drops from the top level down, so it takes O(log n)
+ * steps on average.
+ */
+static void skip_find(void *bp, void **preds)
+{
+  void *p = NULL;
+  void *next;
+  int i;
+
+  for (i = SKIPLEVELS - 1; i >= 0; i--) {
+    while ((next = p ? (i ? SKIP_NEXT(p, i) : NEXT_FREE(p)) : heap->skip_heads[i]) != heap->skip_end &&
+           next < bp)
+      p = next;
+    preds[i] = p;
+  }
 }
 
 /*
- * find_fit - Attempts to find a free block of at least the given size in the free list.
- *
- * This function implements a first-fit search strategy for an explicit free list, which 
- * is simply a doubly linked list of free blocks.
+ * insert_freeblock - Links the free block bp into every level of its height, in address order.
  */
-static void *find_fit(size_t size)
+static void insert_freeblock(void *bp)
 {
-  // First-fit search 
-  void *bp;
+  void *preds[SKIPLEVELS];
+  int height = skip_height(bp);
+  int i;
+
+  skip_find(bp, preds);
+
+  // Level 0 is the doubly linked free list that find_fit walks
+  SET_NEXT_FREE(bp, preds[0] ? NEXT_FREE(preds[0]) : heap->skip_heads[0]);
+  SET_PREV_FREE(bp, preds[0]);
+  if (NEXT_FREE(bp) != heap->skip_end)
+    SET_PREV_FREE(NEXT_FREE(bp), bp);
+  if (preds[0])
+    SET_NEXT_FREE(preds[0], bp);
+  else
+    heap->skip_heads[0] = heap->free_listp = bp;
+
+  for (i = 1; i < height; i++) {
+    if (preds[i]) {
+      SET_SKIP_NEXT(bp, i, SKIP_NEXT(preds[i], i));
+      SET_SKIP_NEXT(preds[i], i, bp);
+    }
+    else {
+      SET_SKIP_NEXT(bp, i, heap->skip_heads[i]);
+      heap->skip_heads[i] = bp;
+    }
+  }
+}
 
-  /* Iterate through the free list and try to find a free block
-   * large enough */
-  for (bp = free_listp; GET_ALLOC(HDRP(bp)) == 0; bp = NEXT_FREE(bp)) {
-    if (size <= GET_SIZE(HDRP(bp))) 
-      return bp; 
+/*
+ * remove_freeblock - Unlinks the free block bp from every level of its height. Level 0 is
+ * doubly linked, so the search for predecessors is only needed for blocks on higher levels.
+ */
+static void remove_freeblock(void *bp)
+{
+  void *preds[SKIPLEVELS];
+  int height = skip_height(bp);
+  int i;
+
+  if (NEXTFIT && heap->rover == bp)
+    heap->rover = NEXT_FREE(bp);
+  if (PREV_FREE(bp))
+    SET_NEXT_FREE(PREV_FREE(bp), NEXT_FREE(bp));
+  else
+    heap->skip_heads[0] = heap->free_listp = NEXT_FREE(bp);
+  if (NEXT_FREE(bp) != heap->skip_end)
+    SET_PREV_FREE(NEXT_FREE(bp), PREV_FREE(bp));
+
+  if (height == 1)
+    return;
+  skip_find(bp, preds);
+  for (i = 1; i < height; i++) {
+    if (preds[i])
+      SET_SKIP_NEXT(preds[i], i, SKIP_NEXT(bp, i));
+    else
+      heap->skip_heads[i] = SKIP_NEXT(bp, i);
   }
-  // Otherwise no free block was large enough
-  return NULL; 
 }
 
+#else
+
 /*
  * remove_freeblock - Removes the given free block pointed to by bp from the free list.
  * 
@@ -344,15 +2018,29 @@ static void *find_fit(size_t size)
 static void remove_freeblock(void *bp)
 {
   if(bp) {
+    if (NEXTFIT && heap->rover == bp)
+      heap->rover = NEXT_FREE(bp);
     if (PREV_FREE(bp))
-      NEXT_FREE(PREV_FREE(bp)) = NEXT_FREE(bp);
+      SET_NEXT_FREE(PREV_FREE(bp), NEXT_FREE(bp));
     else
-      free_listp = NEXT_FREE(bp);
+      heap->free_listp = NEXT_FREE(bp);
     if(NEXT_FREE(bp) != NULL)
-      PREV_FREE(NEXT_FREE(bp)) = PREV_FREE(bp);
+      SET_PREV_FREE(NEXT_FREE(bp), PREV_FREE(bp));
   }
 }
 
+/*
+ * insert_freeblock - Inserts the free block bp at the front of the free list (LIFO policy).
+ */
+static void insert_freeblock(void *bp)
+{
+  SET_NEXT_FREE(bp, heap->free_listp);
+  SET_PREV_FREE(heap->free_listp, bp);
+  SET_PREV_FREE(bp, NULL);
+  heap->free_listp = bp;
+}
+
+#endif /* FITINDEX, ADDRORDER */
 
 
 /*
@@ -366,29 +2054,35 @@ static void remove_freeblock(void *bp)
 static void *coalesce(void *bp)
 {
   // Determine the current allocation state of the previous and next blocks 
-  size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp))) || PREV_BLKP(bp) == bp;
+  size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
   size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
 
   // Get the size of the current free block
   size_t size = GET_SIZE(HDRP(bp));
 
+  /* A ZEROED block stays so when it only merges with a ZEROED block in front, as a fresh
+   * extension does with the wilderness, once the boundary tags between the two are cleared */
+  int zeroed = IS_ZEROED(bp) && next_alloc && (prev_alloc || IS_ZEROED(PREV_BLKP(bp)));
+
   /* If the next block is free, then coalesce the current block
    * (bp) and the next block */
   if (prev_alloc && !next_alloc) {           // Case 2 (in text) 
     size += GET_SIZE(HDRP(NEXT_BLKP(bp)));  
     remove_freeblock(NEXT_BLKP(bp));
-    PUT(HDRP(bp), PACK(size, 0));
-    PUT(FTRP(bp), PACK(size, 0));
+    put_block(bp, size, 0, 1);
   }
 
   /* If the previous block is free, then coalesce the current
    * block (bp) and the previous block */
   else if (!prev_alloc && next_alloc) {      // Case 3 (in text) 
-    size += GET_SIZE(HDRP(PREV_BLKP(bp)));
-    bp = PREV_BLKP(bp); 
+    void *prev = PREV_BLKP(bp);
+
+    size += GET_SIZE(HDRP(prev));
+    if (zeroed)   // Clear the footer and header left in the middle of the merged block
+      memset(HDRP(bp) - WSIZE, 0, DSIZE);
+    bp = prev; 
     remove_freeblock(bp);
-    PUT(HDRP(bp), PACK(size, 0));
-    PUT(FTRP(bp), PACK(size, 0));
+    put_block(bp, size, 0, 1);
   } 
 
   /* If the previous block and next block are free, coalesce
@@ -399,20 +2093,20 @@ static void *coalesce(void *bp)
     remove_freeblock(PREV_BLKP(bp));
     remove_freeblock(NEXT_BLKP(bp));
     bp = PREV_BLKP(bp);
-    PUT(HDRP(bp), PACK(size, 0));
-    PUT(FTRP(bp), PACK(size, 0));
+    put_block(bp, size, 0, 1);
   }
 
-  // Insert the coalesced block at the front of the free list 
-  NEXT_FREE(bp) = free_listp;
-  PREV_FREE(free_listp) = bp;
-  PREV_FREE(bp) = NULL;
-  free_listp = bp;
+  if (zeroed)
+    SET_ZEROED(bp);
+
+  // Insert the coalesced block into the free list
+  insert_freeblock(bp);
 
   // Return the coalesced block 
   return bp;
 }
 
+
 /*
  * place - Places a block of the given size in the free block pointed to by the given
  * pointer bp.
@@ -428,25 +2122,70 @@ static void place(void *bp, size_t asize)
   // Gets the total size of the free block 
   size_t fsize = GET_SIZE(HDRP(bp));
 
-  // Case 1: Splitting is performed 
+  // Case 1: Splitting is performed. The rest is still ZEROED if the old links stay behind.
   if((fsize - asize) >= (MINBLOCKSIZE)) {
+    int zeroed = IS_ZEROED(bp) && asize >= LINKBYTES;
 
-    PUT(HDRP(bp), PACK(asize, 1));
-    PUT(FTRP(bp), PACK(asize, 1));
     remove_freeblock(bp);
+    put_block(bp, asize, 1, GET_PREV_ALLOC(HDRP(bp)));
     bp = NEXT_BLKP(bp);
-    PUT(HDRP(bp), PACK(fsize-asize, 0));
-    PUT(FTRP(bp), PACK(fsize-asize, 0));
+    put_block(bp, fsize-asize, 0, 1);
+    if (zeroed)
+      SET_ZEROED(bp);
     coalesce(bp);
   }
 
   // Case 2: Splitting not possible. Use the full free block 
   else {
 
-    PUT(HDRP(bp), PACK(fsize, 1));
-    PUT(FTRP(bp), PACK(fsize, 1));
     remove_freeblock(bp);
+    put_block(bp, fsize, 1, GET_PREV_ALLOC(HDRP(bp)));
+  }
+}
+
+/*
+ * put_block - Writes the header of a block of the given size at bp, recording whether it and the
+ * block before it are allocated, and its footer. The header of the next block is updated to match
+ * bp's allocated bit.
+ */
+static void put_block(void *bp, size_t size, int alloc, int prev_alloc)
+{
+  PUT(HDRP(bp), PACK(size, alloc) | (prev_alloc ? PREVALLOC : 0));
+  PUT(FTRP(bp), PACK(size, alloc));
+  bp = NEXT_BLKP(bp);
+  PUT(HDRP(bp), (GET(HDRP(bp)) & ~PREVALLOC) | (alloc ? PREVALLOC : 0));
+}
+
+/*
+ * place_by_size - Places a block of the given size in the free block bp like place, but
+ * chooses the end of bp to carve it from by size, and returns the payload pointer.
+ *
+ * Blocks of SPLITHIGH bytes or more are carved from the high end and smaller ones from the
+ * low end, so large and small blocks cut from the same free block end up on opposite sides
+ * of it. When one kind is freed its space merges back into the remaining free block instead
+ * of leaving holes between blocks of the other kind. The wilderness is always carved from
+ * the low end, so that the free space at the end of the heap stays in one piece.
+ */
+static void *place_by_size(void *bp, size_t asize)
+{
+  size_t fsize = GET_SIZE(HDRP(bp));
+
+  if (asize < SPLITHIGH || (fsize - asize) < MINBLOCKSIZE || GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0) {
+    place(bp, asize);
+    return bp;
   }
+
+  // Shrink the free block in place; its neighbors are unchanged, so there is nothing to coalesce
+  int zeroed = IS_ZEROED(bp);
+
+  remove_freeblock(bp);
+  put_block(bp, fsize-asize, 0, GET_PREV_ALLOC(HDRP(bp)));
+  if (zeroed)
+    SET_ZEROED(bp);
+  insert_freeblock(bp);
+  bp = NEXT_BLKP(bp);
+  put_block(bp, asize, 1, 0);
+  return bp;
 }
 
 // consistency checker
@@ -498,3 +2237,307 @@ static void place(void *bp, size_t asize)
 
 
 
+
+/*
+ * place_aligned - Allocates a block of asize bytes whose payload starts on an align boundary
+ * (align being a power of two), and returns its payload pointer, or NULL if out of memory. The
+ * bytes split off in front of the block are stored in *gapp unless gapp is NULL.
+ *
+ * A free block with room for the block past its leading gap is found, or else the
+ * heap is grown by just enough to hold the block at the first aligned spot past its end. The gap
+ * in front of the aligned payload is split off as a block of its own, and then the block is
+ * placed as usual. A gap of a quick list size is pushed on its quick list like a freed block, so
+ * that it waits for a request of its size instead of lengthening the free list; a larger one goes
+ * back to the free list.
+ */
+static void *place_aligned(size_t asize, size_t align, size_t *gapp)
+{
+  size_t fsize, gap;
+  char *bp;
+
+  if ((bp = find_fit(asize, align)) == NULL &&
+      (heap->quick_count == 0 || (quick_flush(), bp = find_fit(asize, align)) == NULL)) {
+    bp = (char *)mem_region_hi(heap->region) + 1;
+    if ((bp = extend_heap((align_gap(bp, align) + asize)/WSIZE)) == NULL)
+      return NULL;
+  }
+
+  gap = align_gap(bp, align);
+  if (gapp)
+    *gapp = gap;
+
+  if (gap) {
+    int zeroed = IS_ZEROED(bp);
+    int quick = gap <= QUICKMAX;
+
+    fsize = GET_SIZE(HDRP(bp));
+    remove_freeblock(bp);
+    put_block(bp, gap, quick, GET_PREV_ALLOC(HDRP(bp)));
+    if (!quick) {
+      if (zeroed)
+        SET_ZEROED(bp);
+      insert_freeblock(bp);
+    }
+    bp += gap;
+    put_block(bp, fsize - gap, 0, quick);
+    if (zeroed && gap >= LINKBYTES)
+      SET_ZEROED(bp);
+    insert_freeblock(bp);
+    place(bp, asize);
+
+    // Only now that the gap is walled in by the placed block may a quick list flush coalesce it
+    if (quick)
+      quick_push(bp - gap, gap);
+    return bp;
+  }
+  place(bp, asize);
+  return bp;
+}
+
+/*
+ * align_gap - Returns the distance from bp to the first payload address at or after it that is
+ * aligned to align and leaves a gap big enough to form a free block (or no gap at all).
+ */
+static size_t align_gap(void *bp, size_t align)
+{
+  size_t gap = ROUNDUP((unsigned long)bp, align) - (unsigned long)bp;
+
+  if (gap && gap < MINBLOCKSIZE)
+    gap += align;
+  return gap;
+}
+
+/*
+ * slab_alloc - Allocates an object of the given size (at most SLABMAX bytes) from a slab of
+ * its size class, starting a new slab if none of them has a free slot.
+ */
+static void *slab_alloc(size_t size)
+{
+  int cls = SLAB_CLASS(size);
+  slab_t *slab = heap->slab_lists[cls];
+  int i, slot;
+
+  // Start a new slab page: all of its slots are free
+  if (slab == NULL) {
+    if ((slab = place_aligned(SLABSIZE, SLABSIZE, NULL)) == NULL)
+      return NULL;
+    slab->objsize = (cls + 1) * ALIGNMENT;
+    slab->first = ROUNDUP(SLAB_HDRSIZE, MIN(slab->objsize & -slab->objsize, SLABALIGN));
+    slab->nslots = (SLABSIZE - OVERHEAD - slab->first) / slab->objsize;
+    slab->nfree = slab->nslots;
+    memset(slab->bitmap, 0, sizeof(slab->bitmap));
+    for (i = 0; i < slab->nslots; i++)
+      slab->bitmap[i / 32] |= 1u << (i % 32);
+    slab->prev = slab->next = NULL;
+    heap->slab_lists[cls] = slab;
+    pagemap_set(slab, SLABSIZE, PM_SLAB, cls, heap->id);
+  }
+
+  // Take the lowest free slot
+  for (i = 0; slab->bitmap[i] == 0; i++)
+    ;
+  slot = i * 32 + __builtin_ctz(slab->bitmap[i]);
+  slab->bitmap[i] &= ~(1u << (slot % 32));
+
+  // A full slab leaves its list
+  if (--slab->nfree == 0) {
+    heap->slab_lists[cls] = slab->next;
+    if (slab->next)
+      slab->next->prev = NULL;
+  }
+  return (char *)slab + slab->first + slot * slab->objsize;
+}
+
+/*
+ * slab_free - Returns the slab object bp to its slab. A slab that was full goes back on its
+ * size class list; a slab that becomes empty is freed back to the heap, unless it is the only
+ * slab of its class with free slots.
+ */
+static void slab_free(void *bp)
+{
+  slab_t *slab = pagemap_span(bp);
+  int cls = SLAB_CLASS(slab->objsize);
+  int slot = ((char *)bp - (char *)slab - slab->first) / slab->objsize;
+
+  slab->bitmap[slot / 32] |= 1u << (slot % 32);
+
+  if (slab->nfree++ == 0) {
+    slab->prev = NULL;
+    slab->next = heap->slab_lists[cls];
+    if (slab->next)
+      slab->next->prev = slab;
+    heap->slab_lists[cls] = slab;
+  }
+  else if (slab->nfree == slab->nslots && (slab->prev || slab->next)) {
+    if (slab->prev)
+      slab->prev->next = slab->next;
+    else
+      heap->slab_lists[cls] = slab->next;
+    if (slab->next)
+      slab->next->prev = slab->prev;
+    pagemap_set(slab, SLABSIZE, PM_NONE, 0, heap->id);
+    mm_free(slab);
+  }
+}
+
+/*
+ * slab_objsize - Returns the object size of the slab holding bp, or 0 if bp is not a slab object.
+ */
+static int slab_objsize(void *bp)
+{
+  page_t *page = pagemap_get(bp);
+
+  return page->kind == PM_SLAB ? (page->sizeclass + 1) * ALIGNMENT : 0;
+}
+
+/*
+ * heap_of - Returns the heap the block bp belongs to: the heap being worked on if bp lies in
+ * it, or else the heap whose id the page map records for bp's page.
+ */
+static inline mm_heap_t *heap_of(void *bp)
+{
+  if ((char *)bp > heap->heap_listp && (char *)bp < heap->end)
+    return heap;
+  return heaps[pagemap_get(bp)->arena];
+}
+
+/*
+ * pool_grow - Takes a new chunk for pool from the heap, records it in the page map and puts it
+ * on the pool's list of chunks with free objects. Returns NULL if out of memory.
+ */
+static pool_chunk_t *pool_grow(mm_pool_t *pool)
+{
+  pool_chunk_t *chunk;
+
+  if ((chunk = place_aligned(pool->chunksize, pool->chunkalign, NULL)) == NULL)
+    return NULL;
+  chunk->free = NULL;
+  chunk->nfree = chunk->nfresh = pool->nobjs;
+  pagemap_set(chunk, pool->chunksize, PM_POOL, 0, heap->id);
+  pool_link(&pool->chunks, chunk);
+  return chunk;
+}
+
+/*
+ * pool_link - Pushes chunk on the front of list.
+ */
+static void pool_link(pool_chunk_t **list, pool_chunk_t *chunk)
+{
+  chunk->prev = NULL;
+  chunk->next = *list;
+  if (chunk->next)
+    chunk->next->prev = chunk;
+  *list = chunk;
+}
+
+/*
+ * pool_unlink - Removes chunk from list.
+ */
+static void pool_unlink(pool_chunk_t **list, pool_chunk_t *chunk)
+{
+  if (chunk->prev)
+    chunk->prev->next = chunk->next;
+  else
+    *list = chunk->next;
+  if (chunk->next)
+    chunk->next->prev = chunk->prev;
+}
+
+/*
+ * pool_release - Records the pages of the chunk of pool as ordinary heap pages again and frees
+ * its block.
+ */
+static void pool_release(mm_pool_t *pool, pool_chunk_t *chunk)
+{
+  pagemap_set(chunk, pool->chunksize, PM_NONE, 0, heap->id);
+  mm_free(chunk);
+}
+
+#if SIZECHECK
+/*
+ * check_size - Aborts unless size could be the size last asked for the allocated block bp: at
+ * most its slab object size, or a size whose block is bp's less a remainder too small to split.
+ */
+static void check_size(void *bp, size_t size)
+{
+  int objsize = slab_objsize(bp);
+  size_t bsize = GET_SIZE(HDRP(bp));
+
+  if (objsize ? size > objsize :
+      !GET_ALLOC(HDRP(bp)) || ASIZE(size) > bsize || bsize - ASIZE(size) >= MINBLOCKSIZE) {
+    fprintf(stderr, "mm_free_sized: size %zu does not match the block at %p\n", size, bp);
+    abort();
+  }
+}
+#endif
+
+/*
+ * quick_push - Pushes the block bp of the given size on the quick list for its size, marked
+ * allocated, and flushes the lists once QUICKCOUNT blocks are waiting. Any GROWN tag is dropped,
+ * the next owner has not grown the block.
+ */
+static void quick_push(void *bp, size_t size)
+{
+  put_block(bp, size, 1, GET_PREV_ALLOC(HDRP(bp)));
+  SET_NEXT_FREE(bp, heap->quick_lists[size / ALIGNMENT]);
+  heap->quick_lists[size / ALIGNMENT] = bp;
+  if (++heap->quick_count >= QUICKCOUNT)
+    quick_flush();
+}
+
+/*
+ * quick_flush - Empties the quick lists, freeing and coalescing every block they held.
+ */
+static void quick_flush(void)
+{
+  void *bp;
+  size_t size;
+  int i;
+
+  for (i = 0; i < NQUICK; i++) {
+    while ((bp = heap->quick_lists[i])) {
+      heap->quick_lists[i] = NEXT_FREE(bp);
+      size = GET_SIZE(HDRP(bp));
+      put_block(bp, size, 0, GET_PREV_ALLOC(HDRP(bp)));
+      coalesce(bp);
+    }
+  }
+  heap->quick_count = 0;
+  heap->counters.quick_flushes++;
+}
+
+/*
+ * mm_counters - Copies the event counters kept since the last mm_init into *c, summed over the
+ * heaps that mm_init sets up again: the default heap, the lifetime heaps and the handle heap.
+ */
+void mm_counters(mm_counters_t *c)
+{
+  mm_heap_t *hs[NLIFETIMES + 1];
+  mm_counters_t *k;
+  int i, n = 0;
+
+  hs[n++] = &default_heap;
+  for (i = 1; i < NLIFETIMES; i++)
+    if (life_heaps[i])
+      hs[n++] = life_heaps[i];
+  if (handles.heap)
+    hs[n++] = handles.heap;
+
+  memset(c, 0, sizeof(*c));
+  for (i = 0; i < n; i++) {
+    k = &hs[i]->counters;
+    c->quick_hits += k->quick_hits;
+    c->quick_misses += k->quick_misses;
+    c->quick_flushes += k->quick_flushes;
+    c->fit_searches += k->fit_searches;
+    c->fit_probes += k->fit_probes;
+    c->calloc_bytes += k->calloc_bytes;
+    c->zero_skipped += k->zero_skipped;
+    c->aligned_allocs += k->aligned_allocs;
+    c->align_gap_bytes += k->align_gap_bytes;
+    c->compact_steps += k->compact_steps;
+    c->compact_moves += k->compact_moves;
+    c->compact_bytes += k->compact_bytes;
+    c->compact_max_step = MAX(c->compact_max_step, k->compact_max_step);
+  }
+}
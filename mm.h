@@ -3,7 +3,75 @@
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
+extern void mm_free_sized(void *ptr, size_t size);
 extern void *mm_realloc(void *ptr, size_t size);
+extern size_t mm_usable_size(void *ptr);
+extern int mm_try_expand(void *ptr, size_t size);
+extern void *mm_calloc(size_t nmemb, size_t size);
+extern void *mm_memalign(size_t align, size_t size);
+extern void *mm_aligned_alloc(size_t align, size_t size);
+extern int mm_malloc_batch(size_t size, int n, void **out);
+extern void mm_free_batch(void **ptrs, int n);  /* sorts ptrs */
+
+/* Heaps apart from the default one that the functions above work on */
+typedef struct mm_heap mm_heap_t;
+
+extern mm_heap_t *mm_heap_create(void);
+extern void *mm_heap_malloc(mm_heap_t *h, size_t size);
+extern void mm_heap_free(mm_heap_t *h, void *ptr);
+extern void *mm_heap_realloc(mm_heap_t *h, void *ptr, size_t size);
+extern int mm_heap_reset(mm_heap_t *h);  /* NULL resets the default heap */
+extern void mm_heap_destroy(mm_heap_t *h);
+
+/* Heaps in named shared memory that cooperating processes allocate from and free into */
+extern mm_heap_t *mm_heap_create_shared(const char *name, size_t size);
+extern mm_heap_t *mm_heap_attach(const char *name);
+extern int mm_heap_unlink(const char *name);
+extern size_t mm_heap_offset(mm_heap_t *h, void *ptr);  /* the same in every process */
+extern void *mm_heap_ptr(mm_heap_t *h, size_t offset);
+
+/* Expected lifetimes for mm_malloc_hint */
+#define MM_LIFE_SHORT  0   /* freed soon after use (the default heap) */
+#define MM_LIFE_MEDIUM 1
+#define MM_LIFE_LONG   2   /* kept for much of the program's run */
+
+extern void *mm_malloc_hint(size_t size, int lifetime);
+
+/* Pools of fixed-size objects with no per-object header */
+typedef struct mm_pool mm_pool_t;
+
+extern mm_pool_t *mm_pool_create(size_t objsize, size_t align);
+extern void *mm_pool_alloc(mm_pool_t *pool);
+extern void mm_pool_free(mm_pool_t *pool, void *obj);
+extern void mm_pool_destroy(mm_pool_t *pool);
+
+/* Relocatable blocks, reached through handles, that mm_compact moves while they are unpinned */
+typedef unsigned int mm_handle_t;   /* 0 is no handle */
+
+extern mm_handle_t mm_halloc(size_t size);
+extern void *mm_hpin(mm_handle_t h);
+extern void mm_hunpin(mm_handle_t h);
+extern void mm_hfree(mm_handle_t h);
+extern int mm_compact(size_t budget);  /* 1 while the pass has more to do */
+
+/* Event counters kept by the allocator since the last mm_init */
+typedef struct {
+    unsigned long quick_hits;    /* mallocs served from a quick list */
+    unsigned long quick_misses;  /* mallocs of a quick list size that found it empty */
+    unsigned long quick_flushes; /* times the quick lists were flushed */
+    unsigned long fit_searches;  /* free list searches made by find_fit */
+    unsigned long fit_probes;    /* free blocks examined by those searches */
+    unsigned long calloc_bytes;  /* bytes requested through mm_calloc */
+    unsigned long zero_skipped;  /* bytes of those known to be zero already, and not cleared */
+    unsigned long aligned_allocs;  /* mm_memalign requests over ALIGNMENT */
+    unsigned long align_gap_bytes; /* bytes mm_memalign split off in front of its blocks */
+    unsigned long compact_steps;   /* mm_compact calls */
+    unsigned long compact_moves;   /* handle blocks those moved */
+    unsigned long compact_bytes;   /* bytes they copied to move them */
+    unsigned long compact_max_step; /* most bytes copied by one of them */
+} mm_counters_t;
+
+extern void mm_counters(mm_counters_t *c);
 
 
 /* 
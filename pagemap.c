@@ -0,0 +1,94 @@
+/*
+ * pagemap.c - a radix tree from page numbers to page descriptors, kept
+ *     alongside memlib so that an allocator can find the metadata of
+ *     any heap address (e.g., the slab holding a header-less object)
+ *     from a raw pointer.
+ *
+ * The page number of an address is split into root, mid and leaf
+ * indexes (see pagemap.h). Mid-level nodes and leaves are allocated
+ * with the libc malloc package on first use and never freed; a heap
+ * only reaches a handful of them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pagemap.h"
+
+page_t **pagemap_root[1 << PM_ROOTBITS]; /* the root level */
+page_t pagemap_none;                     /* descriptor of unrecorded pages */
+
+/*
+ * pagemap_leaf - return the leaf that holds the descriptor of page pn,
+ *     allocating the path to it if necessary
+ */
+static page_t *pagemap_leaf(uintptr_t pn)
+{
+    page_t ***midp = &pagemap_root[PM_ROOTIDX(pn)];
+    page_t **leafp;
+
+    if (*midp == NULL &&
+	(*midp = calloc(1UL << PM_MIDBITS, sizeof(page_t *))) == NULL) {
+	fprintf(stderr, "pagemap: calloc error\n");
+	exit(1);
+    }
+    leafp = &(*midp)[PM_MIDIDX(pn)];
+    if (*leafp == NULL &&
+	(*leafp = calloc(1UL << PM_LEAFBITS, sizeof(page_t))) == NULL) {
+	fprintf(stderr, "pagemap: calloc error\n");
+	exit(1);
+    }
+    return *leafp;
+}
+
+/*
+ * pagemap_set - record kind, sizeclass and arena for every page of the
+ *     span [addr, addr+len), along with each page's offset in the span
+ */
+void pagemap_set(void *addr, size_t len, int kind, int sizeclass, int arena)
+{
+    uintptr_t first = (uintptr_t)addr >> PM_PAGESHIFT;
+    uintptr_t last = ((uintptr_t)addr + len - 1) >> PM_PAGESHIFT;
+    uintptr_t pn;
+    page_t *page;
+
+    if (len == 0)
+	return;
+    for (pn = first; pn <= last; pn++) {
+	page = &pagemap_leaf(pn)[PM_LEAFIDX(pn)];
+	page->kind = kind;
+	page->sizeclass = sizeclass;
+	page->arena = arena;
+	page->spanoff = pn - first;
+    }
+}
+
+/*
+ * pagemap_clear - forget every page of [addr, addr+len)
+ */
+void pagemap_clear(void *addr, size_t len)
+{
+    uintptr_t first = (uintptr_t)addr >> PM_PAGESHIFT;
+    uintptr_t last = ((uintptr_t)addr + len - 1) >> PM_PAGESHIFT;
+    uintptr_t pn;
+    page_t *page;
+
+    if (len == 0)
+	return;
+    for (pn = first; pn <= last; pn++) {
+	page = pagemap_get((void *)(pn << PM_PAGESHIFT));
+	if (page != &pagemap_none)
+	    memset(page, 0, sizeof(page_t));
+    }
+}
+
+/*
+ * pagemap_span - return the address of the first page of the span
+ *     holding addr
+ */
+void *pagemap_span(void *addr)
+{
+    uintptr_t pn = (uintptr_t)addr >> PM_PAGESHIFT;
+
+    return (void *)((pn - pagemap_get(addr)->spanoff) << PM_PAGESHIFT);
+}
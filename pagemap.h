@@ -0,0 +1,71 @@
+#ifndef __PAGEMAP_H_
+#define __PAGEMAP_H_
+
+/*
+ * pagemap.h - a radix tree mapping heap pages to page descriptors
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define PM_PAGESHIFT 12                   /* log2 of the page size tracked */
+#define PM_PAGESIZE  (1 << PM_PAGESHIFT)
+
+/* Kinds of pages */
+#define PM_NONE 0   /* nothing recorded (ordinary boundary-tagged blocks) */
+#define PM_SLAB 1   /* a slab of small objects of one size class */
+#define PM_POOL 2   /* a chunk of a fixed-size object pool */
+
+/* Describes one page */
+typedef struct {
+    unsigned char kind;       /* what the page holds (PM_xxx) */
+    unsigned char sizeclass;  /* size class of a PM_SLAB page */
+    unsigned short arena;     /* heap instance the page belongs to */
+    unsigned int spanoff;     /* pages from the start of the page's span */
+} page_t;
+
+/* Record kind, sizeclass and arena for every page of the span [addr, addr+len) */
+void pagemap_set(void *addr, size_t len, int kind, int sizeclass, int arena);
+
+/* Forget the pages of [addr, addr+len) */
+void pagemap_clear(void *addr, size_t len);
+
+/* Return the first address of the span holding addr */
+void *pagemap_span(void *addr);
+
+/*
+ * The tree has three levels: a static root, then mid-level nodes and
+ * leaves of descriptors that are allocated as the heap reaches them.
+ */
+#if UINTPTR_MAX > 0xffffffffUL
+#define PM_ADDRBITS 48              /* significant virtual address bits */
+#else
+#define PM_ADDRBITS 32
+#endif
+#define PM_LEAFBITS 10
+#define PM_MIDBITS  ((PM_ADDRBITS - PM_PAGESHIFT - PM_LEAFBITS) / 2)
+#define PM_ROOTBITS (PM_ADDRBITS - PM_PAGESHIFT - PM_LEAFBITS - PM_MIDBITS)
+
+#define PM_ROOTIDX(pn) (((pn) >> (PM_LEAFBITS + PM_MIDBITS)) & ((1UL << PM_ROOTBITS) - 1))
+#define PM_MIDIDX(pn)  (((pn) >> PM_LEAFBITS) & ((1UL << PM_MIDBITS) - 1))
+#define PM_LEAFIDX(pn) ((pn) & ((1UL << PM_LEAFBITS) - 1))
+
+extern page_t **pagemap_root[1 << PM_ROOTBITS];
+extern page_t pagemap_none;
+
+/*
+ * pagemap_get - Return the descriptor of the page holding addr. Pages
+ *     never set read as an all-zero (PM_NONE) descriptor. This sits on
+ *     the free path, so it is inline: three dependent loads.
+ */
+static inline page_t *pagemap_get(void *addr)
+{
+    uintptr_t pn = (uintptr_t)addr >> PM_PAGESHIFT;
+    page_t **mid = pagemap_root[PM_ROOTIDX(pn)];
+    page_t *leaf;
+
+    if (mid == NULL || (leaf = mid[PM_MIDIDX(pn)]) == NULL)
+	return &pagemap_none;
+    return &leaf[PM_LEAFIDX(pn)];
+}
+
+#endif /* __PAGEMAP_H_ */
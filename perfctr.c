@@ -0,0 +1,78 @@
+/*
+ * perfctr.c - Count hardware events (e.g., dTLB or cache misses) incurred by a
+ *     function f, using the Linux perf_event interface. On systems
+ *     without it, or where the event is not supported, every count is
+ *     reported as unavailable.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "perfctr.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* 
+ * perfctr_open - Open a counter for event on the calling thread. The
+ *     counter is created disabled and counts user-mode events only.
+ */
+static int perfctr_open(int event)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    switch (event) {
+    case PERFCTR_DTLB_MISSES:
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB |
+	    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	break;
+    case PERFCTR_CACHE_MISSES:
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	break;
+    default:
+	return -1;
+    }
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * perfctr - Return the number of times event occurred while running
+ *     f(argp) once, or -1 if the event can't be counted.
+ */
+double perfctr(int event, perfctr_test_funct f, void *argp)
+{
+    long long count;
+    int fd;
+
+    if ((fd = perfctr_open(event)) < 0)
+	return -1;
+
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    f(argp);
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+	count = -1;
+    close(fd);
+    return (double)count;
+}
+
+#else /* !__linux__ */
+
+double perfctr(int event, perfctr_test_funct f, void *argp)
+{
+    return -1;
+}
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * perfctr.h - hardware event counting for a test function f
+ */
+typedef void (*perfctr_test_funct)(void *);
+
+/* Events that perfctr can count */
+#define PERFCTR_DTLB_MISSES 0   /* data TLB load misses */
+#define PERFCTR_CACHE_MISSES 1  /* last-level cache misses */
+
+/* Count the occurrences of event during one run of f(argp).
+   Returns -1 if the event cannot be counted on this system */
+double perfctr(int event, perfctr_test_funct f, void *argp);
@@ -0,0 +1,17 @@
+# Aging pattern: 150K ops of random sizes, mostly 16 bytes to 4 KB with the odd one up to 64 KB,
+# and random lifetimes, over a live population of 2000-4000 blocks.
+# Usage: python3 traces/gen-aging.py > traces/aging.rep
+import random
+random.seed(36)
+ops=[]; live=[]; nid=0
+for step in range(150000):
+    if len(live) < 4000 and (len(live) < 2000 or random.random() < 0.5):
+        r=random.random()
+        size = int(2**random.uniform(4,12)) if r<0.97 else int(2**random.uniform(12,16))
+        ops.append("a %d %d"%(nid,size)); live.append(nid); nid+=1
+    else:
+        i=random.randrange(len(live)); live[i],live[-1]=live[-1],live[i]
+        ops.append("f %d"%live.pop())
+for x in live: ops.append("f %d"%x)
+print(0); print(nid); print(len(ops)); print(1)
+print("\n".join(ops))
@@ -0,0 +1,29 @@
+# Request-processing pattern: each round allocates a batch of same-sized nodes (plus a few
+# unrelated singles), and frees earlier batches whole. B=1 writes batch ops, B=0 the same
+# requests as single a/f ops.
+# Usage: python3 traces/gen-batch.py 1 > traces/batch.rep
+#        python3 traces/gen-batch.py 0 > traces/batch-single.rep
+import random, sys
+random.seed(7)
+batch = sys.argv[1] == '1'
+ops = []; nid = 0; live = []; singles = []
+for r in range(3000):
+    n = random.choice([16, 24, 32, 48, 64]); size = random.choice([72, 96, 136, 200, 264])
+    ids = list(range(nid, nid + n)); nid += n
+    if batch: ops.append('A %d %d %d' % (ids[0], n, size))
+    else: ops += ['a %d %d' % (i, size) for i in ids]
+    live.append((ids[0], n))
+    if random.random() < 0.5:
+        ops.append('a %d %d' % (nid, random.randint(16, 2000))); singles.append(nid); nid += 1
+    while len(live) > 4:
+        f, k = live.pop(random.randrange(len(live)))
+        if batch: ops.append('F %d %d' % (f, k))
+        else: ops += ['f %d' % i for i in range(f, f + k)]
+    if len(singles) > 20:
+        ops.append('f %d' % singles.pop(random.randrange(len(singles))))
+for f, k in live:
+    if batch: ops.append('F %d %d' % (f, k))
+    else: ops += ['f %d' % i for i in range(f, f + k)]
+for s in singles: ops.append('f %d' % s)
+print(20000000); print(nid); print(len(ops)); print(1)
+print('\n'.join(ops))
@@ -0,0 +1,35 @@
+# Cache-tier pattern: entries whose typical size grows from phase to phase are evicted at random
+# once the cache is full, so the holes left by old entries seldom suit new ones. Entries are
+# pinned around short uses, a few for long stretches. H=1 writes handle ops, H=0 plain a/f ops.
+# Usage: python3 traces/gen-handle.py 1 > traces/handle.rep
+#        python3 traces/gen-handle.py 0 > traces/handle-plain.rep
+import random, sys
+random.seed(21)
+handles = sys.argv[1] == '1'
+ops = []; nid = 0; live = []; pinned = {}
+CAP = 1500
+for phase in range(8):
+    lo, hi = 40 * 2**phase // 2, 40 * 2**phase
+    for r in range(6000):
+        if len(live) >= CAP or (live and random.random() < 0.3):
+            i = live.pop(random.randrange(len(live)))
+            if i in pinned:
+                if handles: ops.append('k %d' % i)
+                del pinned[i]
+            ops.append(('h %d' if handles else 'f %d') % i)
+        ops.append(('H %d %d' if handles else 'a %d %d') % (nid, random.randint(lo, hi)))
+        live.append(nid); nid += 1
+        # use an entry: pin it, and unpin entries whose use is over
+        if live and random.random() < 0.2:
+            i = random.choice(live)
+            if i not in pinned:
+                pinned[i] = r + (random.randint(1, 20) if random.random() < 0.95 else 3000)
+                if handles: ops.append('K %d' % i)
+        for i in [i for i, t in pinned.items() if t <= r]:
+            if handles: ops.append('k %d' % i)
+            del pinned[i]
+for i in pinned:
+    if handles: ops.append('k %d' % i)
+for i in live: ops.append(('h %d' if handles else 'f %d') % i)
+print(20000000); print(nid); print(len(ops)); print(1)
+print('\n'.join(ops))
@@ -0,0 +1,27 @@
+# Lifetime pattern: cache entries of a few sizes accumulate for the whole run, allocated amid
+# bursts of temporaries whose sizes change from burst to burst, so the holes a burst leaves
+# between cache entries seldom suit the next one. H=1 hints the cache entries ('l' ops).
+# Usage: python3 traces/gen-life.py 0 > traces/life.rep
+#        python3 traces/gen-life.py 1 > traces/life-hint.rep
+import random, sys
+random.seed(5)
+hint = sys.argv[1] == '1'
+longsizes = [136, 520, 1096]
+ops = []; nid = 0; cache = []; temps = []
+for burst in range(60):
+    tsize = random.choice([48, 200, 700, 1800, 3000, 6000])
+    for r in range(random.randint(200, 500)):
+        ops.append('a %d %d' % (nid, random.randint(tsize // 2, tsize)))
+        temps.append(nid); nid += 1
+        if random.random() < 0.1:
+            s = random.choice(longsizes)
+            ops.append(('l %d %d 2' if hint else 'a %d %d') % (nid, s)); cache.append(nid); nid += 1
+    random.shuffle(temps)
+    while len(temps) > 10:
+        ops.append('f %d' % temps.pop())
+    # the odd eviction from the cache
+    for _ in range(len(cache) // 50):
+        ops.append('f %d' % cache.pop(random.randrange(len(cache))))
+for i in temps + cache: ops.append('f %d' % i)
+print(20000000); print(nid); print(len(ops)); print(1)
+print('\n'.join(ops))
@@ -0,0 +1,27 @@
+# Node-heavy pattern: list nodes, tree nodes and sessions of fixed sizes whose populations
+# grow and shrink in waves, plus unrelated variable-size requests. P=1 writes pool ops for the
+# fixed-size objects, P=0 the same requests as plain a/f ops.
+# Usage: python3 traces/gen-pool.py 1 > traces/pool.rep
+#        python3 traces/gen-pool.py 0 > traces/pool-plain.rep
+import random, sys
+random.seed(11)
+pool = sys.argv[1] == '1'
+kinds = [24, 48, 152, 328]
+ops = []; nid = 0; live = {k: [] for k in kinds}; other = []
+for r in range(60000):
+    k = random.choice(kinds)
+    target = 400 + 350 * ((r // 5000) % 3)          # waves of live population
+    if len(live[k]) < target and random.random() < 0.6 or not live[k]:
+        ops.append(('P %d %d' if pool else 'a %d %d') % (nid, k)); live[k].append(nid); nid += 1
+    else:
+        i = live[k].pop(random.randrange(len(live[k])))
+        ops.append(('p %d' if pool else 'f %d') % i)
+    if random.random() < 0.05:
+        ops.append('a %d %d' % (nid, random.randint(16, 3000))); other.append(nid); nid += 1
+        if len(other) > 50:
+            ops.append('f %d' % other.pop(random.randrange(len(other))))
+for k in kinds:
+    for i in live[k]: ops.append(('p %d' if pool else 'f %d') % i)
+for i in other: ops.append('f %d' % i)
+print(20000000); print(nid); print(len(ops)); print(1)
+print('\n'.join(ops))